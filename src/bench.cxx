@@ -0,0 +1,735 @@
+#include "bench.hxx"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cpus.hxx"
+#include "engine.hxx"
+#include "fixedbase.hxx"
+#include "keygen.hxx"
+#include "main.hxx"
+#include "rapl.hxx"
+#include "sha256x8.hxx"
+
+extern "C" {
+#include <fp25519_x64.h>
+}
+#include <pthread.h>
+#include <sched.h>
+#include <x86intrin.h>
+
+namespace {
+
+unsigned const DefaultWords  = 3;
+unsigned const DefaultTrials = 10;
+
+// Before the trials every stage runs once for this much of `--bench-time`,
+// unrecorded: page faults, table building, the caches and the branch
+// predictors warming up, and the frequency settling.
+double const WarmUpFraction = 0.25;
+
+// The intervals are percentile bootstrap ones over this many resamples, with
+// a fixed seed so that the same samples always give the same verdict.
+unsigned const      Resamples   = 2000;
+double const        Confidence  = 0.95;
+std::uint64_t const BootstrapSeed = 1;
+
+// Fewer trials than this can't tell a change from the noise.
+std::size_t const MinTrialsToCompare = 3;
+
+// Below this many trials the bootstrap interval of the median is little more
+// than the smallest and the biggest of them: the 95% tails of the resampled
+// medians fall on the extreme samples.
+unsigned const MinTrialsForInterval = 10;
+
+// What `Bench()` returns when a stage got slower than the baseline.
+int const SlowerExitCode = 5;
+
+// Inputs are cycled through so that the stage isn't timed on one hot key.
+std::size_t const nInputs = 1024;
+
+struct Measurement {
+  std::size_t ops{0};
+  double      seconds{0};
+  double      tscCycles{0};
+  double      joules{0};  // of the packages, 0 without RAPL
+};
+
+// Calls `step(i)` for i = 0, 1, ... until `duration` passes.
+template <typename Step>
+Measurement Measure(std::chrono::duration<double> duration, Step &&step) {
+  // Checking the clock is not free, so it is done every this many steps.
+  std::size_t const Stride = 64;
+
+  Measurement measurement;
+  auto const startedAt = std::chrono::steady_clock::now();
+  auto const tscAt     = __rdtsc();
+  for (auto now = startedAt; now - startedAt < duration; now = std::chrono::steady_clock::now()) {
+    for (std::size_t i = 0; i < Stride; ++i) {
+      step(measurement.ops++);
+    }
+  }
+  measurement.tscCycles = static_cast<double>(__rdtsc() - tscAt);
+  measurement.seconds   = std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count();
+  return measurement;
+}
+
+// A row of the table: `measure` runs it once for the given time, with the ops
+// counted in what the row is per. The single-threaded stages run pinned.
+struct Stage {
+  using Measurer = std::function<Measurement(std::chrono::duration<double>)>;
+
+  Stage(std::string name, bool pinned, Measurer measure)
+      : name(std::move(name)), pinned(pinned), measure(std::move(measure)) {}
+
+  std::string name;
+  bool        pinned;
+  Measurer    measure;
+
+  std::vector<double> opsPerSecond;  // one per trial
+  std::vector<double> tscPerOp;
+  std::vector<double> opsPerJoule;
+};
+
+// Pins the calling thread to `cpu` for as long as it lives.
+class Pinned {
+public:
+  explicit Pinned(unsigned cpu) {
+    pthread_getaffinity_np(pthread_self(), sizeof saved_, &saved_);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+  }
+  ~Pinned() { pthread_setaffinity_np(pthread_self(), sizeof saved_, &saved_); }
+
+  Pinned(Pinned const &) = delete;
+  Pinned &operator=(Pinned const &) = delete;
+
+private:
+  cpu_set_t saved_;
+};
+
+double Median(std::vector<double> samples) {
+  if (samples.empty()) {
+    return 0;
+  }
+  auto const middle = samples.begin() + samples.size() / 2;
+  std::nth_element(samples.begin(), middle, samples.end());
+  if (samples.size() % 2) {
+    return *middle;
+  }
+  return (*middle + *std::max_element(samples.begin(), middle)) / 2;
+}
+
+std::vector<double> Resample(std::vector<double> const &samples, std::mt19937_64 &gen) {
+  std::uniform_int_distribution<std::size_t> pick(0, samples.size() - 1);
+  std::vector<double> resampled(samples.size());
+  for (auto &sample : resampled) {
+    sample = samples[pick(gen)];
+  }
+  return resampled;
+}
+
+// The `Confidence` interval of `statistic()` from its bootstrap replicates.
+template <typename Statistic>
+std::pair<double, double> Bootstrap(Statistic &&statistic) {
+  std::vector<double> replicates(Resamples);
+  for (auto &replicate : replicates) {
+    replicate = statistic();
+  }
+  std::sort(replicates.begin(), replicates.end());
+  auto const tail = static_cast<std::size_t>((1 - Confidence) / 2 * Resamples);
+  return {replicates[tail], replicates[Resamples - 1 - tail]};
+}
+
+std::pair<double, double> MedianInterval(std::vector<double> const &samples) {
+  std::mt19937_64 gen(BootstrapSeed);
+  return Bootstrap([&] { return Median(Resample(samples, gen)); });
+}
+
+// Of the relative change of the median from `baseline` to `current`.
+std::pair<double, double> ChangeInterval(std::vector<double> const &current, std::vector<double> const &baseline) {
+  std::mt19937_64 gen(BootstrapSeed);
+  return Bootstrap([&] { return Median(Resample(current, gen)) / Median(Resample(baseline, gen)) - 1; });
+}
+
+// Of the baseline file, for a reader to tell what it is looking at.
+int const BaselineVersion = 1;
+
+std::string JsonString(std::string const &s) {
+  std::string quoted = "\"";
+  for (auto const c : s) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof escaped, "\\u%04x", static_cast<unsigned>(c));
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + '"';
+}
+
+// A strict reader of JSON text, enough for the baseline: strings, numbers,
+// and the punctuation of objects and arrays, each read where the caller
+// expects it. Anything else is an error, with the offset it is at.
+class JsonReader {
+public:
+  explicit JsonReader(std::string text) : text_(std::move(text)) {}
+
+  std::size_t offset() const { return at_; }
+
+  // Takes `c` if it comes next.
+  bool accept(char c) {
+    skipWhitespace();
+    if (at_ < text_.size() && text_[at_] == c) {
+      ++at_;
+      return true;
+    }
+    return false;
+  }
+
+  bool string(std::string &value) {
+    if (!accept('"')) {
+      return false;
+    }
+    value.clear();
+    while (at_ < text_.size()) {
+      auto const c = text_[at_++];
+      if (c == '"') {
+        return true;
+      }
+      if (static_cast<unsigned char>(c) < 0x20) {
+        return false;
+      }
+      if (c != '\\') {
+        value += c;
+        continue;
+      }
+      if (at_ >= text_.size()) {
+        return false;
+      }
+      switch (auto const escaped = text_[at_++]) {
+        case '"': case '\\': case '/': value += escaped; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'u': {
+          // Code points of the basic plane only; surrogate pairs are not
+          // anything the baseline holds.
+          unsigned codePoint = 0;
+          for (unsigned i = 0; i < 4; ++i, ++at_) {
+            auto const digit = at_ < text_.size() ? text_[at_] : '\0';
+            if (!std::isxdigit(static_cast<unsigned char>(digit))) {
+              return false;
+            }
+            codePoint = codePoint * 16 + static_cast<unsigned>(std::isdigit(static_cast<unsigned char>(digit))
+                                                                   ? digit - '0' : std::tolower(digit) - 'a' + 10);
+          }
+          if (codePoint >= 0xd800 && codePoint < 0xe000) {
+            return false;
+          }
+          if (codePoint < 0x80) {
+            value += static_cast<char>(codePoint);
+          } else if (codePoint < 0x800) {
+            value += static_cast<char>(0xc0 | codePoint >> 6);
+            value += static_cast<char>(0x80 | (codePoint & 0x3f));
+          } else {
+            value += static_cast<char>(0xe0 | codePoint >> 12);
+            value += static_cast<char>(0x80 | (codePoint >> 6 & 0x3f));
+            value += static_cast<char>(0x80 | (codePoint & 0x3f));
+          }
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    return false;
+  }
+
+  // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?, the JSON grammar, before
+  // strtod() gets it.
+  bool number(double &value) {
+    skipWhitespace();
+    auto const begin  = at_;
+    auto const digits = [this] {
+      auto const from = at_;
+      while (at_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[at_]))) {
+        ++at_;
+      }
+      return at_ - from;
+    };
+    auto const next = [this](char c) { return at_ < text_.size() && text_[at_] == c; };
+
+    if (next('-')) {
+      ++at_;
+    }
+    if (next('0')) {
+      ++at_;
+    } else if (digits() == 0) {
+      return false;
+    }
+    if (next('.')) {
+      ++at_;
+      if (digits() == 0) {
+        return false;
+      }
+    }
+    if (next('e') || next('E')) {
+      ++at_;
+      if (next('+') || next('-')) {
+        ++at_;
+      }
+      if (digits() == 0) {
+        return false;
+      }
+    }
+    value = std::strtod(text_.substr(begin, at_ - begin).c_str(), nullptr);
+    return true;
+  }
+
+  // Only whitespace is left.
+  bool end() {
+    skipWhitespace();
+    return at_ == text_.size();
+  }
+
+private:
+  void skipWhitespace() {
+    while (at_ < text_.size()
+           && (text_[at_] == ' ' || text_[at_] == '\t' || text_[at_] == '\r' || text_[at_] == '\n')) {
+      ++at_;
+    }
+  }
+
+  std::string text_;
+  std::size_t at_{0};
+};
+
+// The members of an object, each handed to `member` by its key, which reads
+// the value. Every key may come once only.
+template <typename Member>
+bool JsonObject(JsonReader &json, Member &&member) {
+  if (!json.accept('{')) {
+    return false;
+  }
+  if (json.accept('}')) {
+    return true;
+  }
+  std::set<std::string> seen;
+  do {
+    std::string key;
+    if (!json.string(key) || !seen.insert(key).second || !json.accept(':') || !member(key)) {
+      return false;
+    }
+  } while (json.accept(','));
+  return json.accept('}');
+}
+
+// The elements of an array, each read by `element`.
+template <typename Element>
+bool JsonArray(JsonReader &json, Element &&element) {
+  if (!json.accept('[')) {
+    return false;
+  }
+  if (json.accept(']')) {
+    return true;
+  }
+  do {
+    if (!element()) {
+      return false;
+    }
+  } while (json.accept(','));
+  return json.accept(']');
+}
+
+// The baseline as `SaveBaseline()` writes it: the host and the kernels it
+// ran, then the ops/s of every trial of every stage.
+void SaveBaseline(std::string const &path, std::map<std::string, std::string> const &host,
+                  Options const &options, unsigned trials, std::vector<Stage> const &stages) {
+  std::ofstream out(path, std::ios::trunc);
+  out << "{\n  \"version\": " << BaselineVersion << ",\n  \"host\": {";
+  char const *separator = "\n";
+  for (auto const &field : host) {
+    out << separator << "    " << JsonString(field.first) << ": " << JsonString(field.second);
+    separator = ",\n";
+  }
+  out << "\n  },\n"
+      << "  \"benchTime\": " << options.benchTime << ",\n"
+      << "  \"trials\": " << trials << ",\n"
+      << "  \"stages\": [";
+  separator = "\n";
+  for (auto const &stage : stages) {
+    out << separator << "    {\"name\": " << JsonString(stage.name) << ", \"samples\": [" << std::setprecision(9);
+    for (std::size_t i = 0; i < stage.opsPerSecond.size(); ++i) {
+      out << (i ? ", " : "") << stage.opsPerSecond[i];
+    }
+    out << "]}";
+    separator = ",\n";
+  }
+  out << "\n  ]\n}\n";
+  if (!out) {
+    std::cerr << "Can't write the benchmark to " << path << '\n';
+  }
+}
+
+// Reads back what `SaveBaseline()` wrote: that shape, with every member there
+// once and no others, in any order and with any whitespace.
+bool LoadBaseline(std::string const &path, std::map<std::string, std::string> &host,
+                  std::map<std::string, std::vector<double>> &stages) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Can't read the baseline " << path << '\n';
+    return false;
+  }
+  std::ostringstream text;
+  text << in.rdbuf();
+  JsonReader json(text.str());
+
+  double version = 0, number = 0;
+  auto const hostField = [&](std::string const &key) { return json.string(host[key]); };
+  auto const stage = [&] {
+    std::string         name;
+    std::vector<double> samples;
+    bool const ok = JsonObject(json, [&](std::string const &key) {
+      if (key == "name") {
+        return json.string(name);
+      }
+      return key == "samples" && JsonArray(json, [&] {
+        samples.push_back(0);
+        return json.number(samples.back());
+      });
+    });
+    stages[name] = samples;
+    return ok && !name.empty();
+  };
+  std::set<std::string> members;
+  bool const ok = JsonObject(json, [&](std::string const &key) {
+    members.insert(key);
+    if (key == "version") {
+      return json.number(version);
+    } else if (key == "host") {
+      return JsonObject(json, hostField);
+    } else if (key == "benchTime" || key == "trials") {
+      return json.number(number);
+    } else if (key == "stages") {
+      return JsonArray(json, stage);
+    }
+    return false;
+  }) && json.end();
+
+  if (!ok || members.size() != 5) {
+    std::cerr << "Malformed benchmark JSON in " << path << " at byte " << json.offset() << '\n';
+    return false;
+  }
+  if (version != BaselineVersion) {
+    std::cerr << "Not a version " << BaselineVersion << " benchmark: " << path << '\n';
+    return false;
+  }
+  if (stages.empty()) {
+    std::cerr << "No benchmark stages in " << path << '\n';
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int Bench(Options const &options) {
+  std::chrono::duration<double> const duration{options.benchTime};
+  unsigned const nWords = options.nWords ? options.nWords : DefaultWords;
+  unsigned const trials = options.benchTrials ? options.benchTrials : DefaultTrials;
+
+  std::map<std::string, std::vector<double>> baseline;
+  std::map<std::string, std::string>         baselineHost;
+  if (!options.benchBaseline.empty() && !LoadBaseline(options.benchBaseline, baselineHost, baseline)) {
+    return 1;
+  }
+
+  std::mt19937_64 gen(std::random_device{}());
+  std::uniform_int_distribution<unsigned> word(0, DictSize - 1);
+  std::uniform_int_distribution<unsigned> byte(0, 0xff);
+
+  std::vector<unsigned> wordIndices(nInputs * nWords);
+  for (auto &wordIndex : wordIndices) {
+    wordIndex = word(gen);
+  }
+  std::vector<SecretKey> secretKeys(nInputs);
+  for (auto &secretKey : secretKeys) {
+    for (auto &b : secretKey) {
+      b = static_cast<unsigned char>(byte(gen));
+    }
+  }
+
+  std::vector<Stage> stages;
+
+  stages.push_back({"sha256 " + std::to_string(nWords) + "-word passphrase", true, [&](auto d) {
+    SecretKey secretKey;
+    return Measure(d, [&](std::size_t i) {
+      HashPassphrase(&wordIndices[(i % nInputs) * nWords], nWords, secretKey);
+    });
+  }});
+
+  // Eight at a time, the way the engine does it.
+  stages.push_back({"sha256 " + std::to_string(nWords) + "-word x8 (per passphrase)", true, [&](auto d) {
+    std::size_t const            Lanes = 8;
+    std::array<SecretKey, Lanes> output;
+    auto m = Measure(d, [&](std::size_t i) {
+      HashPassphrases(output.data(), &wordIndices[(i * Lanes % (nInputs - Lanes + 1)) * nWords], nWords, Lanes);
+    });
+    m.ops *= Lanes;
+    return m;
+  }});
+
+  for (std::size_t b = 0; b < nKeyGenBackends; ++b) {
+    auto const *backend = &KeyGenBackends[b];
+    stages.push_back({std::string("x25519 ") + backend->name, true, [&, backend](auto d) {
+      PublicKey publicKey;
+      return Measure(d, [&](std::size_t i) {
+        backend->generate(&publicKey, &secretKeys[i % nInputs], 1);
+      });
+    }});
+  }
+
+  // Cycles versus table size of the vartime backend: where this host's caches
+  // and TLBs stop keeping up with the wider windows.
+  std::vector<std::unique_ptr<FixedBaseTable>> tables;
+  for (unsigned w = FixedBaseTable::MinWindowBits; w <= FixedBaseTable::MaxWindowBits; ++w) {
+    tables.push_back(std::make_unique<FixedBaseTable>(w));
+    auto const *table = tables.back().get();
+    stages.push_back({"x25519 vartime w=" + std::to_string(w) + " " + std::to_string(table->size() / 1024) + " KB",
+                      true, [&, table](auto d) {
+      PublicKey publicKey;
+      return Measure(d, [&](std::size_t i) {
+        table->generate(&publicKey, &secretKeys[i % nInputs], 1);
+      });
+    }});
+  }
+
+  // The vartime backend shares one inversion per batch: what smaller batches
+  // (and so a shorter wait for the rest of a batch after a hit) cost per key.
+  for (std::size_t const batch : {1, 2, 4, 8, 16, 64}) {
+    stages.push_back({"x25519 vartime batch=" + std::to_string(batch) + " (per key)", true, [&, batch](auto d) {
+      std::array<PublicKey, FixedBaseTable::MaxBatch> publicKeys;
+      auto m = Measure(d, [&](std::size_t i) {
+        X25519KeyGenVartime(publicKeys.data(), &secretKeys[i * batch % (nInputs - batch + 1)], batch);
+      });
+      m.ops *= batch;
+      return m;
+    }});
+  }
+
+  for (auto const &inversion : {std::make_pair("fermat", inv_EltFp25519_1w_x64),
+                                std::make_pair("safegcd", inv_var_EltFp25519_1w_x64)}) {
+    stages.push_back({std::string("field inversion ") + inversion.first, true, [&, inversion](auto d) {
+      EltFp25519_1w_x64 a, inverse;
+      return Measure(d, [&](std::size_t i) {
+        std::memcpy(a, secretKeys[i % nInputs].data(), sizeof a);
+        inversion.second(inverse, a);
+      });
+    }});
+  }
+
+  // The whole thing, on all the threads (each pinned to a CPU of its own),
+  // hunting for a key no canonical encoding can ever match.
+  Options quiet = options;
+  quiet.verbose    = false;
+  quiet.pinThreads = true;
+  quiet.checkpointPath.clear();
+  quiet.campaign.clear();
+  PublicKey unreachable;
+  unreachable.fill(0xff);
+  auto const engine = [&quiet, nWords, unreachable](std::string const &backend, bool smtSplit) {
+    return [&quiet, nWords, unreachable, backend, smtSplit](std::chrono::duration<double> d) {
+      Options stage = quiet;
+      stage.curveBackend = backend;
+      stage.smtSplit     = smtSplit;
+      auto const result = Run(stage, Target{nWords, unreachable}, d);
+      return Measurement{result.tries, result.elapsedTime.count(), 0};
+    };
+  };
+  for (std::size_t b = 0; b < nKeyGenBackends; ++b) {
+    stages.push_back({std::string("engine ") + KeyGenBackends[b].name + " (all threads)", false,
+                      engine(KeyGenBackends[b].name, false)});
+    // The stages split over the hyperthreads of a core, against the fused
+    // loop of the row above on the same number of threads.
+    if (KeyGenBackends[b].name == std::string(DefaultKeyGenBackend)) {
+      stages.push_back({std::string("engine ") + DefaultKeyGenBackend + " smt-split", false, engine("", true)});
+    }
+  }
+
+  // What the numbers are of: the host, and the kernels the engine picks.
+  auto const     cpus    = AffinityCpus();
+  unsigned const pinCpu  = cpus.empty() ? 0 : cpus.front();
+  CpuModel const model   = ReadCpuModel();
+  auto const     unknown = [](std::string const &s) { return s.empty() ? std::string("n/a") : s; };
+  auto const     mhz     = [](double value) { return value > 0 ? std::to_string(static_cast<long>(value)) : "n/a"; };
+  std::map<std::string, std::string> host{
+      {"cpu", unknown(model.name)},
+      {"microcode", unknown(model.microcode)},
+      {"cpus", std::to_string(cpus.size())},
+      {"mhz", mhz(model.mhz)},
+      {"maxMhz", mhz(model.maxMhz)},
+      {"governor", unknown(model.governor)},
+      {"turbo", unknown(model.turbo)},
+      {"sha256", HashPassphrasesKernel(nWords)},
+      {"x25519", options.curveBackend.empty() ? DefaultKeyGenBackend : options.curveBackend},
+      {"tableBits", std::to_string(SharedFixedBaseTable().windowBits())},
+      {"tablePages", SharedFixedBaseTable().backing()},
+      {"batch", options.batch ? std::to_string(options.batch) : "default"},
+  };
+
+  std::cout << "bench: cpu " << host["cpu"] << "; microcode " << host["microcode"] << "; " << host["cpus"]
+            << " CPUs\n"
+            << "bench: " << host["mhz"] << " MHz now, " << host["maxMhz"] << " MHz max; governor "
+            << host["governor"] << "; turbo " << host["turbo"] << '\n'
+            << "bench: kernels: sha256 " << host["sha256"] << ", x25519 " << host["x25519"] << " (w="
+            << host["tableBits"] << ", " << host["tablePages"] << " pages, batch " << host["batch"] << ")\n"
+            << "bench: " << trials << " trials of " << duration.count() << " s per stage after a "
+            << WarmUpFraction * duration.count() << " s warm-up; single-threaded stages pinned to CPU "
+            << pinCpu << ", engine workers to a CPU each" << std::endl;
+
+  // Trials go round all the stages in turn, so that a slow drift (the
+  // temperature, a noisy neighbour) spreads over them rather than hitting
+  // the trials of one stage.
+  // The energy is of the whole package over the stage, idle cores and all,
+  // so it compares stages of this host rather than tells what one op takes.
+  auto const runStage = [pinCpu](Stage &stage, std::chrono::duration<double> d) {
+    std::unique_ptr<Pinned> pinned;
+    if (stage.pinned) {
+      pinned = std::make_unique<Pinned>(pinCpu);
+    }
+    Rapl rapl;
+    auto m = stage.measure(d);
+    rapl.sample();
+    m.joules = rapl.joules();
+    return m;
+  };
+  for (auto &stage : stages) {
+    runStage(stage, WarmUpFraction * duration);
+  }
+  double tscHz = 0;
+  for (unsigned trial = 0; trial < trials; ++trial) {
+    std::cout << "bench: trial " << trial + 1 << '/' << trials << std::endl;
+    for (auto &stage : stages) {
+      auto const m = runStage(stage, duration);
+      stage.opsPerSecond.push_back(m.ops / m.seconds);
+      if (m.tscCycles > 0) {
+        stage.tscPerOp.push_back(m.tscCycles / m.ops);
+        tscHz = std::max(tscHz, m.tscCycles / m.seconds);
+      }
+      if (m.joules > 0) {
+        stage.opsPerJoule.push_back(m.ops / m.joules);
+      }
+    }
+  }
+  host["tscMhz"] = mhz(tscHz / 1e6);
+
+  auto const percent = static_cast<int>(Confidence * 100);
+  if (trials < MinTrialsForInterval) {
+    std::cout << "bench: note: with fewer than " << MinTrialsForInterval << " trials the " << percent
+              << "% intervals are about the min and max of the trials, not a meaningful interval\n";
+  }
+  std::cout << "bench: " << std::left << std::setw(36) << "stage" << std::right
+            << std::setw(14) << "ops/s" << std::setw(24) << (std::to_string(percent) + "% CI of the median")
+            << std::setw(12) << "ns/op" << std::setw(14) << "TSC cycles/op" << std::setw(12) << "ops/J" << '\n';
+  for (auto const &stage : stages) {
+    auto const median   = Median(stage.opsPerSecond);
+    auto const interval = MedianInterval(stage.opsPerSecond);
+    std::cout << "bench: " << std::left << std::setw(36) << stage.name << std::right << std::fixed
+              << std::setprecision(0) << std::setw(14) << median
+              << std::setw(11) << interval.first << " .. " << std::left << std::setw(9) << interval.second
+              << std::right << std::setprecision(1) << std::setw(12) << 1e9 / median;
+    if (!stage.tscPerOp.empty()) {
+      std::cout << std::setprecision(0) << std::setw(14) << Median(stage.tscPerOp);
+    } else {
+      std::cout << std::setw(14) << '-';
+    }
+    if (!stage.opsPerJoule.empty()) {
+      std::cout << std::setprecision(0) << std::setw(12) << Median(stage.opsPerJoule);
+    } else {
+      std::cout << std::setw(12) << "n/a";
+    }
+    std::cout << std::defaultfloat << std::setprecision(6) << '\n';
+  }
+  std::cout << "bench: TSC at " << host["tscMhz"] << " MHz";
+  if (!Rapl().available()) {
+    std::cout << "; ops/J n/a (no readable /sys/class/powercap/intel-rapl:*)";
+  }
+  std::cout << std::endl;
+
+  if (!options.benchSave.empty()) {
+    SaveBaseline(options.benchSave, host, options, trials, stages);
+    std::cout << "bench: saved to " << options.benchSave << '\n';
+  }
+  if (options.benchBaseline.empty()) {
+    return 0;
+  }
+
+  // A stage is faster or slower when the whole interval of the change of its
+  // median is on that side of zero.
+  std::cout << "bench: against " << options.benchBaseline << " (" << baselineHost["cpu"] << "; sha256 "
+            << baselineHost["sha256"] << ", x25519 " << baselineHost["x25519"] << ")\n";
+  for (auto const &field : {"cpu", "microcode", "governor", "turbo", "sha256", "x25519", "tableBits", "batch"}) {
+    if (baselineHost.count(field) && baselineHost[field] != host[field]) {
+      std::cout << "bench: note: " << field << " was " << baselineHost[field] << ", is " << host[field] << '\n';
+    }
+  }
+  std::cout << "bench: " << std::left << std::setw(36) << "stage" << std::right << std::setw(14) << "baseline"
+            << std::setw(10) << "change" << std::setw(24) << (std::to_string(percent) + "% CI of the change")
+            << "  verdict\n";
+  bool slower = false;
+  for (auto const &stage : stages) {
+    std::cout << "bench: " << std::left << std::setw(36) << stage.name << std::right;
+    auto const found = baseline.find(stage.name);
+    if (found == baseline.end() || found->second.empty()) {
+      std::cout << std::setw(14) << '-' << std::setw(10) << '-' << std::setw(24) << '-' << "  new\n";
+      continue;
+    }
+    auto const &before   = found->second;
+    auto const  change   = Median(stage.opsPerSecond) / Median(before) - 1;
+    auto const  interval = ChangeInterval(stage.opsPerSecond, before);
+    std::ostringstream range;
+    range << std::showpos << std::fixed << std::setprecision(1) << 100 * interval.first << "% .. "
+          << 100 * interval.second << '%';
+
+    char const *verdict = "no change";
+    if (stage.opsPerSecond.size() < MinTrialsToCompare || before.size() < MinTrialsToCompare) {
+      verdict = "too few trials";
+    } else if (interval.first > 0) {
+      verdict = "faster";
+    } else if (interval.second < 0) {
+      verdict = "slower";
+      slower  = true;
+    }
+    std::cout << std::fixed << std::setprecision(0) << std::setw(14) << Median(before) << std::showpos
+              << std::setprecision(1) << std::setw(9) << 100 * change << '%' << std::noshowpos
+              << std::setw(24) << range.str() << "  " << verdict << std::defaultfloat << std::setprecision(6)
+              << '\n';
+  }
+  return slower ? SlowerExitCode : 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "options.hxx"
+
+// Benchmarks the pipeline stages one by one on a single pinned thread
+// (passphrase hashing and every X25519 backend) and then the whole engine with
+// every backend on all the threads, for `options.benchTime` seconds each,
+// after a warm-up and over `options.benchTrials` trials. Reports the median
+// of each with a bootstrap confidence interval and, where RAPL is readable,
+// the ops per joule of package energy, along with the CPU model,
+// frequency policy and kernels. Saves the trials as JSON to
+// `options.benchSave`, and compares them with those of
+// `options.benchBaseline`, stage by stage.
+//
+// Returns the process exit code: 5 when a stage got slower than the baseline.
+int Bench(Options const &options);
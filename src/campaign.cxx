@@ -0,0 +1,260 @@
+#include "campaign.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpus.hxx"
+#include "engine.hxx"
+#include "main.hxx"
+
+char const *const CampaignPolicies[] = {"exhaust-first", "proportional"};
+std::size_t const nCampaignPolicies  = sizeof CampaignPolicies / sizeof CampaignPolicies[0];
+
+namespace {
+
+// How often the threads get handed around; the rates they go by are over
+// about as long.
+std::chrono::seconds const RebalanceInterval{1};
+
+struct Entry {
+  unsigned     nWords;
+  Options      options;
+  CampaignSlot slot;
+  RunResult    result;
+  std::atomic_bool finished{false};
+  std::thread  thread;
+
+  double perThreadRate{0};  // tries/s, the last one measured
+  double credit{0};         // threads owed by the proportional policy
+
+  bool enumerates() const { return options.enumerate; }
+
+  // Passphrases it may still have to try: all of them, for the random search.
+  double left() const {
+    auto const size = slot.size.load();
+    return size ? static_cast<double>(size - std::min(size, slot.tries.load()))
+                : std::pow(static_cast<double>(DictSize), nWords);
+  }
+};
+
+// The rate of a target not measured yet: the mean of those that are, as the
+// word counts hash at about the same speed.
+double RateOrGuess(Entry const &entry, std::vector<std::unique_ptr<Entry>> const &entries) {
+  if (entry.perThreadRate > 0) {
+    return entry.perThreadRate;
+  }
+  double sum = 0;
+  unsigned n = 0;
+  for (auto const &other : entries) {
+    if (other->perThreadRate > 0) {
+      sum += other->perThreadRate;
+      ++n;
+    }
+  }
+  return n ? sum / n : 1;
+}
+
+// Threads for each of `entries` out of `total`, by `policy`.
+std::vector<unsigned> Allocate(std::string const &policy, std::vector<std::unique_ptr<Entry>> &entries,
+                               unsigned total) {
+  std::vector<unsigned> threads(entries.size(), 0);
+
+  if (policy == CampaignPolicies[0]) {
+    std::size_t best = entries.size();
+    double      bestTime = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      auto const &entry = *entries[i];
+      if (entry.finished.load() || !entry.enumerates()) {
+        continue;
+      }
+      double const time = entry.left() / RateOrGuess(entry, entries);
+      if (time < bestTime) {
+        best     = i;
+        bestTime = time;
+      }
+    }
+    if (best < entries.size()) {
+      threads[best] = total;
+      return threads;
+    }
+    // Only random searches left: they take equal turns below.
+  }
+
+  // Shares of a hit per second, in threads, paid out whole from the credit
+  // they pile up: a target owed half a thread gets one every other time.
+  std::vector<double> weights(entries.size(), 0);
+  double sum = 0;
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    auto const &entry = *entries[i];
+    if (entry.finished.load()) {
+      continue;
+    }
+    weights[i] = policy == CampaignPolicies[0] ? 1 : RateOrGuess(entry, entries) / std::max(1.0, entry.left());
+    sum += weights[i];
+  }
+  if (sum <= 0) {
+    return threads;
+  }
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    entries[i]->credit = weights[i] > 0 ? entries[i]->credit + total * weights[i] / sum : 0;
+  }
+  for (unsigned given = 0; given < total; ++given) {
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < entries.size(); ++i) {
+      if (entries[i]->credit > entries[best]->credit) {
+        best = i;
+      }
+    }
+    ++threads[best];
+    entries[best]->credit -= 1;
+  }
+  return threads;
+}
+
+}  // namespace
+
+int Campaign(Options const &options) {
+  std::string const policy = options.policy.empty() ? CampaignPolicies[0] : options.policy;
+
+  // The pool: what a single run would get.
+  CpuBudget const budget   = ReadCpuBudget();
+  unsigned const  perWorker = options.smtSplit ? 2 : 1;
+  unsigned const  total    = std::max(1u, (options.threads ? options.threads : budget.threads()) / perWorker);
+  char const     *unit     = options.smtSplit ? " pairs" : " threads";
+
+  std::vector<std::unique_ptr<Entry>> entries;
+  for (auto const nWords : options.campaign) {
+    auto entry = std::make_unique<Entry>();
+    entry->nWords            = nWords;
+    entry->options           = options;
+    entry->options.nWords    = nWords;
+    entry->options.verbose   = false;
+    entry->options.reportInterval = 0;
+    entry->options.enumerate = nWords <= MaxEnumerateWords;
+    entry->options.permute   = options.permute && entry->options.enumerate;
+    if (!entry->options.enumerate) {
+      entry->options.checkpointPath.clear();
+      entry->options.shardIndex = 0;
+      entry->options.shardCount = 1;
+    } else if (!options.checkpointPath.empty()) {
+      entry->options.checkpointPath = options.checkpointPath + '.' + std::to_string(nWords);
+    }
+    if (!options.statsName.empty()) {
+      entry->options.statsName = options.statsName + '-' + std::to_string(nWords);
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  std::cout << "Campaign: " << entries.size() << " targets on " << total << unit << ", " << policy << '\n';
+  for (auto const &entry : entries) {
+    std::cout << "  " << entry->nWords << " words: " << Wallets[entry->nWords - 1] << "; "
+              << (entry->options.permute ? "permute" : entry->enumerates() ? "enumerate" : "random");
+    if (!entry->options.checkpointPath.empty()) {
+      std::cout << "; checkpoint " << entry->options.checkpointPath;
+    }
+    std::cout << '\n';
+  }
+
+  auto threads = Allocate(policy, entries, total);
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    auto &entry = *entries[i];
+    entry.slot.threads.store(threads[i]);
+    entry.thread = std::thread([&entry] {
+      entry.result = Run(entry.options, Target{entry.nWords, PublicKeys[entry.nWords - 1]},
+                         std::chrono::duration<double>::zero(), &entry.slot);
+      entry.finished.store(true);
+    });
+  }
+
+  auto const printThreads = [&] {
+    std::cout << "Threads:";
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      std::cout << ' ' << entries[i]->nWords << "w=" << threads[i];
+    }
+    std::cout << std::endl;
+  };
+  printThreads();
+
+  auto const startedAt    = std::chrono::steady_clock::now();
+  auto       rebalancedAt = startedAt;
+  auto       reportedAt   = startedAt;
+  auto const anyRunning   = [&entries] {
+    return std::any_of(entries.cbegin(), entries.cend(), [](auto const &entry) { return !entry->finished.load(); });
+  };
+  while (anyRunning()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto const now = std::chrono::steady_clock::now();
+
+    // A run that finished gives its threads back right away.
+    bool freed = false;
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      freed = freed || (entries[i]->finished.load() && threads[i] > 0);
+    }
+    if (freed || now - rebalancedAt >= RebalanceInterval) {
+      for (auto &entry : entries) {
+        auto const active = entry->slot.active.load();
+        auto const rate   = entry->slot.rate.load();
+        if (active > 0 && rate > 0) {
+          entry->perThreadRate = rate / active;
+        }
+      }
+      auto const next = Allocate(policy, entries, total);
+      if (next != threads) {
+        threads = next;
+        for (std::size_t i = 0; i < entries.size(); ++i) {
+          entries[i]->slot.threads.store(threads[i]);
+        }
+        if (anyRunning()) {
+          printThreads();
+        }
+      }
+      rebalancedAt = now;
+    }
+
+    if (options.reportInterval <= 0
+        || now - reportedAt < std::chrono::duration<double>(options.reportInterval)) {
+      continue;
+    }
+    std::cout << '[' << std::chrono::duration<double>(now - startedAt).count() << " s]";
+    for (auto const &entry : entries) {
+      if (entry->finished.load()) {
+        std::cout << ' ' << entry->nWords << "w: done;";
+        continue;
+      }
+      std::cout << ' ' << entry->nWords << "w: " << entry->slot.rate.load() << " tries/s, "
+                << entry->slot.tries.load() << " tries";
+      if (entry->enumerates()) {
+        std::cout << " of " << entry->slot.size.load();
+      }
+      std::cout << ';';
+    }
+    std::cout << std::endl;
+    reportedAt = now;
+  }
+
+  bool failed = false;
+  std::cout << "Campaign over in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - startedAt).count()
+            << " s\n";
+  for (auto &entry : entries) {
+    entry->thread.join();
+    auto const &result = entry->result;
+    failed = failed || result.failed;
+    std::cout << "  " << entry->nWords << " words: "
+              << (result.failed ? "failed to start"
+                  : result.hit ? "HIT \"" + PassphraseString(result.passphrase) + '"'
+                  : result.exhausted ? std::string("keyspace exhausted") : std::string("stopped"))
+              << "; " << result.tries << " tries in " << result.elapsedTime.count() << " s";
+    if (result.stopLatency.count() > 0) {
+      std::cout << "; stopped in " << result.stopLatency.count() * 1e3 << " ms";
+    }
+    std::cout << '\n';
+  }
+  return failed ? 1 : 0;
+}
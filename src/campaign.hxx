@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+#include "options.hxx"
+
+// Runs the built-in targets of `options.campaign` word counts in one
+// process, on one pool of threads: every target gets a run with a worker
+// per CPU, and a coordinator keeps as many of them in all unparked as the
+// budget allows, handing them around once a second by `options.policy`:
+//
+//  * exhaust-first: all of them to the enumeration with the least time left,
+//    going by its live rate; the targets past `MaxEnumerateWords` get them
+//    once there is none;
+//  * proportional: each live target a share in proportion to its chance of a
+//    hit per second (its rate over the passphrases it has left), taking turns
+//    where the shares come to less than a thread.
+//
+// With `--checkpoint <path>` each enumeration resumes from and saves to
+// `<path>.<words>` of its own.
+//
+// Returns the process exit code.
+int Campaign(Options const &options);
+
+// The names `--policy` takes, the first one being the default.
+extern char const *const CampaignPolicies[];
+extern std::size_t const  nCampaignPolicies;
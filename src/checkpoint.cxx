@@ -0,0 +1,116 @@
+#include "checkpoint.hxx"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+namespace {
+
+char const Header[] = "burst-passphrase checkpoint 1";
+
+}  // namespace
+
+bool LoadCheckpoint(std::string const &path, std::uint64_t size, Checkpoint &checkpoint, bool &found) {
+  // Missing is told from unreadable before the stream, which keeps no errno.
+  struct stat status;
+  found = stat(path.c_str(), &status) == 0;
+  if (!found) {
+    if (errno == ENOENT) {
+      return true;
+    }
+    std::cerr << "Can't read the checkpoint " << path << ": " << std::strerror(errno) << '\n';
+    return false;
+  }
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Can't read the checkpoint " << path << '\n';
+    return false;
+  }
+
+  std::string line;
+  if (!std::getline(in, line) || line != Header) {
+    std::cerr << "Not a checkpoint: " << path << '\n';
+    return false;
+  }
+
+  Checkpoint loaded;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string        name;
+    fields >> name;
+
+    bool ok = true;
+    if (name.empty()) {
+      continue;
+    } else if (name == "words") {
+      ok = static_cast<bool>(fields >> loaded.nWords);
+    } else if (name == "order") {
+      std::string order;
+      ok = fields >> order && (order == "enumerate" || order == "permute");
+      loaded.permute = order == "permute";
+    } else if (name == "key") {
+      ok = static_cast<bool>(fields >> loaded.key);
+    } else if (name == "shard") {
+      char slash = 0;
+      ok = fields >> loaded.shardIndex >> slash >> loaded.shardCount && slash == '/';
+    } else if (name == "pending") {
+      std::pair<std::uint64_t, std::uint64_t> range;
+      ok = fields >> range.first >> range.second && range.first < range.second && range.second <= size;
+      loaded.pending.push_back(range);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::cerr << "Malformed checkpoint line in " << path << ": " << line << '\n';
+      return false;
+    }
+  }
+
+  CoalesceRanges(loaded.pending);
+  checkpoint = std::move(loaded);
+  return true;
+}
+
+bool SaveCheckpoint(std::string const &path, Checkpoint const &checkpoint) {
+  std::string const temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::trunc);
+    out << Header << '\n'
+        << "words " << checkpoint.nWords << '\n'
+        << "order " << (checkpoint.permute ? "permute" : "enumerate") << '\n'
+        << "key " << checkpoint.key << '\n'
+        << "shard " << checkpoint.shardIndex << '/' << checkpoint.shardCount << '\n';
+    for (auto const &range : checkpoint.pending) {
+      out << "pending " << range.first << ' ' << range.second << '\n';
+    }
+    out.flush();
+    if (!out) {
+      std::cerr << "Can't write the checkpoint to " << temporary << ": " << std::strerror(errno) << '\n';
+      return false;
+    }
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::cerr << "Can't move the checkpoint to " << path << ": " << std::strerror(errno) << '\n';
+    return false;
+  }
+  return true;
+}
+
+void CoalesceRanges(std::vector<std::pair<std::uint64_t, std::uint64_t>> &ranges) {
+  std::sort(ranges.begin(), ranges.end());
+  std::size_t merged = 0;
+  for (auto const &range : ranges) {
+    if (merged > 0 && range.first <= ranges[merged - 1].second) {
+      ranges[merged - 1].second = std::max(ranges[merged - 1].second, range.second);
+    } else {
+      ranges[merged++] = range;
+    }
+  }
+  ranges.resize(merged);
+}
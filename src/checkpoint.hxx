@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Where an enumeration got to, for `--checkpoint` to pick it up again.
+//
+// The pending ranges are positions in the walk order: the passphrase index
+// itself for `--enumerate`, the input of the keyed permutation for
+// `--permute`. The rest is there so that a checkpoint is never resumed with
+// another order, key or shard than it was written with. It is a text file,
+// one thing per line:
+//
+//    burst-passphrase checkpoint 1
+//    words 3
+//    order permute
+//    key 0
+//    shard 0/1
+//    pending 1200 4096
+//    pending 70000 4298942376
+//
+// and a finished walk has no pending lines left.
+struct Checkpoint {
+  unsigned      nWords{0};
+  bool          permute{false};
+  std::uint64_t key{0};
+  unsigned      shardIndex{0};
+  unsigned      shardCount{1};
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> pending;  // [begin, end), sorted, disjoint
+};
+
+// Reads `path` into `checkpoint`, of a walk of `size` positions. A missing
+// file is not an error, only not `found`; a malformed one is, and gets told on
+// stderr, as is a pending range that is empty or runs past `size`.
+bool LoadCheckpoint(std::string const &path, std::uint64_t size, Checkpoint &checkpoint, bool &found);
+
+// Writes a temporary file next to `path` and renames it over, so that a crash
+// leaves the old checkpoint or the new one, never half of either.
+bool SaveCheckpoint(std::string const &path, Checkpoint const &checkpoint);
+
+// Sorts `ranges` and merges those that overlap or touch.
+void CoalesceRanges(std::vector<std::pair<std::uint64_t, std::uint64_t>> &ranges);
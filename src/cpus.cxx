@@ -0,0 +1,277 @@
+#include "cpus.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+namespace {
+
+struct Mount {
+  std::string root;        // of the hierarchy, as seen from here
+  std::string mountPoint;
+};
+
+// The cgroup v2 mount and the v1 one that has the cpu controller, from
+// /proc/self/mountinfo.
+void FindCgroupMounts(Mount &v2, Mount &v1Cpu) {
+  std::ifstream in("/proc/self/mountinfo");
+  for (std::string line; std::getline(in, line); ) {
+    // id parent major:minor root mount-point options [optional...] - type source super-options
+    std::istringstream fields(line);
+    std::string id, parent, device, root, mountPoint, options, field;
+    fields >> id >> parent >> device >> root >> mountPoint >> options;
+    while (fields >> field && field != "-") {
+    }
+    std::string type, source, superOptions;
+    fields >> type >> source >> superOptions;
+
+    if (type == "cgroup2" && v2.mountPoint.empty()) {
+      v2 = {root, mountPoint};
+    } else if (type == "cgroup" && v1Cpu.mountPoint.empty()) {
+      std::istringstream controllers(superOptions);
+      for (std::string controller; std::getline(controllers, controller, ','); ) {
+        if (controller == "cpu") {
+          v1Cpu = {root, mountPoint};
+        }
+      }
+    }
+  }
+}
+
+// Our cgroup in the v2 hierarchy ("0::/path") and in the v1 one of the cpu
+// controller ("N:cpu,cpuacct:/path"), from /proc/self/cgroup.
+void FindOwnCgroups(std::string &v2, std::string &v1Cpu) {
+  std::ifstream in("/proc/self/cgroup");
+  for (std::string line; std::getline(in, line); ) {
+    auto const first  = line.find(':');
+    auto const second = line.find(':', first + 1);
+    if (first == std::string::npos || second == std::string::npos) {
+      continue;
+    }
+    std::string const controllers = line.substr(first + 1, second - first - 1);
+    std::string const path        = line.substr(second + 1);
+
+    if (line.compare(0, first, "0") == 0 && controllers.empty()) {
+      v2 = path;
+    }
+    std::istringstream list(controllers);
+    for (std::string controller; std::getline(list, controller, ','); ) {
+      if (controller == "cpu") {
+        v1Cpu = path;
+      }
+    }
+  }
+}
+
+// The directories of our cgroup and of its ancestors up to what is mounted.
+std::vector<std::string> CgroupDirs(Mount const &mount, std::string const &cgroup) {
+  std::vector<std::string> dirs;
+  if (mount.mountPoint.empty()) {
+    return dirs;
+  }
+
+  // Inside a cgroup namespace or a container the mount shows a subtree only.
+  std::string relative = cgroup;
+  if (mount.root != "/" && relative.compare(0, mount.root.size(), mount.root) == 0) {
+    relative.erase(0, mount.root.size());
+  } else if (mount.root != "/") {
+    relative.clear();
+  }
+
+  for (;;) {
+    dirs.push_back(mount.mountPoint + relative);
+    auto const slash = relative.find_last_of('/');
+    if (relative.empty() || slash == std::string::npos) {
+      break;
+    }
+    relative.erase(slash);
+  }
+  return dirs;
+}
+
+// The tightest of the quotas along the way, in CPUs.
+void ReadQuotaV2(std::vector<std::string> const &dirs, double &quota, std::string &path) {
+  for (auto const &dir : dirs) {
+    std::ifstream in(dir + "/cpu.max");
+    std::string max;
+    double period = 0;
+    if (!(in >> max >> period) || max == "max" || period <= 0) {
+      continue;
+    }
+    double const cpus = std::stod(max) / period;
+    if (quota == 0 || cpus < quota) {
+      quota = cpus;
+      path  = dir + "/cpu.max";
+    }
+  }
+}
+
+void ReadQuotaV1(std::vector<std::string> const &dirs, double &quota, std::string &path) {
+  for (auto const &dir : dirs) {
+    std::ifstream quotaIn(dir + "/cpu.cfs_quota_us");
+    std::ifstream periodIn(dir + "/cpu.cfs_period_us");
+    double max = 0, period = 0;
+    if (!(quotaIn >> max) || !(periodIn >> period) || max <= 0 || period <= 0) {
+      continue;
+    }
+    double const cpus = max / period;
+    if (quota == 0 || cpus < quota) {
+      quota = cpus;
+      path  = dir + "/cpu.cfs_quota_us";
+    }
+  }
+}
+
+// A sysfs CPU list: "0-3,8,10-11".
+std::vector<unsigned> ParseCpuList(std::string const &list) {
+  std::vector<unsigned> cpus;
+  std::istringstream    ranges(list);
+  for (std::string range; std::getline(ranges, range, ','); ) {
+    unsigned first = 0, last = 0;
+    char     dash  = 0;
+    std::istringstream bounds(range);
+    if (!(bounds >> first)) {
+      continue;
+    }
+    if (!(bounds >> dash >> last) || dash != '-') {
+      last = first;
+    }
+    for (unsigned cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+}  // namespace
+
+unsigned CpuBudget::cpus() const {
+  return std::max(1u, affinity ? affinity : hardware);
+}
+
+unsigned CpuBudget::threads() const {
+  unsigned n = cpus();
+  if (quota > 0) {
+    n = std::min(n, static_cast<unsigned>(std::ceil(quota)));
+  }
+  return std::max(1u, n);
+}
+
+CpuBudget ReadCpuBudget() {
+  CpuBudget budget;
+  budget.hardware = std::thread::hardware_concurrency();
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof set, &set) == 0) {
+    budget.affinity = static_cast<unsigned>(CPU_COUNT(&set));
+  }
+
+  Mount       v2Mount, v1Mount;
+  std::string v2Cgroup, v1Cgroup;
+  FindCgroupMounts(v2Mount, v1Mount);
+  FindOwnCgroups(v2Cgroup, v1Cgroup);
+  ReadQuotaV2(CgroupDirs(v2Mount, v2Cgroup), budget.quota, budget.quotaPath);
+  if (budget.quota == 0) {
+    ReadQuotaV1(CgroupDirs(v1Mount, v1Cgroup), budget.quota, budget.quotaPath);
+  }
+
+  return budget;
+}
+
+std::vector<std::vector<unsigned>> CoreSiblings() {
+  std::vector<std::vector<unsigned>> cores;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof set, &set) != 0) {
+    return cores;
+  }
+
+  std::vector<bool> seen(CPU_SETSIZE);
+  for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &set) || seen[cpu]) {
+      continue;
+    }
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list");
+    std::string   list;
+    std::getline(in, list);
+
+    std::vector<unsigned> core;
+    for (auto const sibling : ParseCpuList(list)) {
+      if (sibling < CPU_SETSIZE && CPU_ISSET(sibling, &set) && !seen[sibling]) {
+        seen[sibling] = true;
+        core.push_back(sibling);
+      }
+    }
+    if (core.empty()) {
+      seen[cpu] = true;
+      core.push_back(cpu);
+    }
+    cores.push_back(core);
+  }
+  return cores;
+}
+
+std::vector<unsigned> AffinityCpus() {
+  std::vector<unsigned> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof set, &set) == 0) {
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+CpuModel ReadCpuModel() {
+  CpuModel model;
+  auto const cpus = AffinityCpus();
+  unsigned const cpu = cpus.empty() ? 0 : cpus.front();
+
+  // "name<tabs>: value" lines, a block per CPU.
+  std::ifstream in("/proc/cpuinfo");
+  bool          ours = false;
+  for (std::string line; std::getline(in, line); ) {
+    auto const colon = line.find(':');
+    if (colon == std::string::npos) {
+      continue;
+    }
+    std::string name  = line.substr(0, line.find_last_not_of(" \t", colon - 1) + 1);
+    std::string value = colon + 2 <= line.size() ? line.substr(colon + 2) : std::string();
+    if (name == "processor") {
+      ours = std::stoul(value) == cpu;
+    } else if (ours && name == "model name") {
+      model.name = value;
+    } else if (ours && name == "microcode") {
+      model.microcode = value;
+    } else if (ours && name == "cpu MHz") {
+      model.mhz = std::stod(value);
+    }
+  }
+
+  std::string const cpufreq = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/";
+  std::ifstream maxIn(cpufreq + "scaling_max_freq");
+  double        maxKhz = 0;
+  if (maxIn >> maxKhz) {
+    model.maxMhz = maxKhz / 1000;
+  }
+  std::ifstream(cpufreq + "scaling_governor") >> model.governor;
+
+  // intel_pstate says whether turbo is off, acpi-cpufreq whether boost is on.
+  int flag = 0;
+  if (std::ifstream("/sys/devices/system/cpu/intel_pstate/no_turbo") >> flag) {
+    model.turbo = flag ? "off" : "on";
+  } else if (std::ifstream("/sys/devices/system/cpu/cpufreq/boost") >> flag) {
+    model.turbo = flag ? "on" : "off";
+  }
+  return model;
+}
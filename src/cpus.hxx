@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// How many CPUs we may actually use, which in a container is usually less
+// than `std::thread::hardware_concurrency()` tells: the cpuset (through the
+// affinity mask) limits which CPUs, the CFS quota (`cpu.max` of cgroup v2,
+// `cpu.cfs_quota_us` of v1) how much time on them. Running more threads than
+// the quota covers gets the whole pod throttled for the rest of each period.
+struct CpuBudget {
+  unsigned    hardware{0};  // hardware_concurrency()
+  unsigned    affinity{0};  // CPUs of our affinity mask
+  double      quota{0};     // CPUs worth of quota, 0 when unlimited
+  std::string quotaPath;    // where the quota came from
+
+  // CPUs we may run on at all.
+  unsigned cpus() const;
+  // Threads to run: those CPUs, cut down to the quota rounded up.
+  unsigned threads() const;
+};
+
+CpuBudget ReadCpuBudget();
+
+// The CPUs of our affinity mask grouped by the core they are hyperthreads of
+// (/sys/devices/system/cpu/cpuN/topology/thread_siblings_list), in the order
+// of their first CPU. Without SMT every group is a single CPU.
+std::vector<std::vector<unsigned>> CoreSiblings();
+
+// The CPUs of our affinity mask, in order.
+std::vector<unsigned> AffinityCpus();
+
+// What a benchmark result should be filed with, as far as it is readable:
+// the model from /proc/cpuinfo, the frequency policy from cpufreq and
+// intel_pstate of the first CPU of our affinity mask. Empty or 0 is unknown,
+// which is what virtual machines mostly tell.
+struct CpuModel {
+  std::string name;
+  std::string microcode;
+  double      mhz{0};     // right now, per /proc/cpuinfo
+  double      maxMhz{0};  // cpufreq scaling_max_freq
+  std::string governor;
+  std::string turbo;      // "on" or "off"
+};
+
+CpuModel ReadCpuModel();
@@ -0,0 +1,1102 @@
+#include "engine.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <fstream>
+#include <forward_list>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "checkpoint.hxx"
+#include "cpus.hxx"
+#include "fixedbase.hxx"
+#include "keygen.hxx"
+#include "perf.hxx"
+#include "permutation.hxx"
+#include "rapl.hxx"
+#include "scheduler.hxx"
+#include "sha256.hxx"
+#include "sha256x8.hxx"
+#include "spsc.hxx"
+#include "stats.hxx"
+#include "trace.hxx"
+#include "utils.hxx"
+
+#include <gsl/gsl>
+#include <immintrin.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+
+void HashPassphrase(unsigned const *wordIndices, unsigned nWords, SecretKey &secretKey) {
+  Sha256 hasher;
+  // To avoid building a phrase by joining strings with a whitespace character
+  // and to prevent unnecessary memory allocations we run the first separately
+  // and run the loop for the rest:
+  //  * feed the hasher with the first word...
+  hasher.update(Words[wordIndices[0]]);
+  //  * feed with the rest words with the leading whitespace character.
+  for (unsigned i = 1; i < nWords; ++i) {
+    hasher.update(Whitespace);
+    hasher.update(Words[wordIndices[i]]);
+  }
+  hasher.final(secretKey);
+}
+
+namespace {
+
+// Keys per keygen call. The vartime backend shares one inversion per batch,
+// and the bigger the batch, the longer a hit waits for the rest of it.
+std::size_t const DefaultBatch = 8;
+
+// Enumeration chunks are sized to take about this long, as measured by the
+// worker so far: long enough for the scheduling to be noise, short enough
+// that the last chunks don't keep the others waiting.
+std::chrono::duration<double> const TargetChunkTime{0.01};
+std::uint64_t const                 FirstChunk = 256;
+
+// Passphrases of an enumeration, in order: the index written in base
+// DictSize, the first word being the least significant digit.
+class Odometer {
+public:
+  explicit Odometer(unsigned nWords) : digits_(nWords) {}
+
+  void set(std::uint64_t index) {
+    for (auto &digit : digits_) {
+      digit = static_cast<unsigned>(index % DictSize);
+      index /= DictSize;
+    }
+  }
+
+  unsigned const *digits() const { return digits_.data(); }
+
+private:
+  std::vector<unsigned> digits_;
+};
+
+// The way of an enumeration from the [0, size()) the scheduler hands out to
+// passphrase indices: first onto the positions still to do (the shard, or
+// what a checkpoint left of it), then through the keyed permutation with
+// `--permute`. Checkpoints are kept in positions, so that they stay valid
+// whatever the number of workers of the run that picks them up.
+class Walk {
+public:
+  using Ranges = std::vector<std::pair<std::uint64_t, std::uint64_t>>;
+
+  Walk(Ranges ranges, std::uint64_t keyspace, bool permute, std::uint64_t key)
+      : ranges_(std::move(ranges)), permute_(permute), permutation_(keyspace, key) {
+    starts_.push_back(0);
+    for (auto const &range : ranges_) {
+      starts_.push_back(starts_.back() + range.second - range.first);
+    }
+  }
+
+  std::uint64_t size() const { return starts_.back(); }
+
+  std::uint64_t index(std::uint64_t at) const {
+    auto const i        = range(at);
+    auto const position = ranges_[i].first + (at - starts_[i]);
+    return permute_ ? permutation_(position) : position;
+  }
+
+  // Appends the positions [begin, end) of the walk stands for.
+  void positions(std::uint64_t begin, std::uint64_t end, Ranges &out) const {
+    for (auto i = begin < end ? range(begin) : ranges_.size(); i < ranges_.size() && starts_[i] < end; ++i) {
+      auto const from = std::max(begin, starts_[i]) - starts_[i];
+      auto const to   = std::min(end, starts_[i + 1]) - starts_[i];
+      out.emplace_back(ranges_[i].first + from, ranges_[i].first + to);
+    }
+  }
+
+private:
+  std::size_t range(std::uint64_t at) const {
+    return static_cast<std::size_t>(std::upper_bound(starts_.cbegin(), starts_.cend() - 1, at) - starts_.cbegin() - 1);
+  }
+
+  Ranges                     ranges_;
+  std::vector<std::uint64_t> starts_;  // of each range in the walk, and the size
+  bool                       permute_;
+  KeyspacePermutation        permutation_;
+};
+
+// How often a `--checkpoint` is written while running; it is also written at
+// the end.
+std::chrono::seconds const CheckpointInterval{10};
+
+// How many of the workers are to run; those past the count wait parked in
+// `park()` until it grows back or the run is over. It also tells the stop of
+// the run: when it came, for the time to wind down, and to the reporting loop,
+// so that it does not sleep through it.
+class ThreadControl {
+public:
+  explicit ThreadControl(unsigned active) : active_(active) {}
+
+  unsigned active() const { return active_.load(std::memory_order_relaxed); }
+
+  void setActive(unsigned active) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      active_.store(active, std::memory_order_relaxed);
+    }
+    wakeup_.notify_all();
+  }
+
+  void park(unsigned index, std::atomic_bool const &isDone) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeup_.wait(lock, [&] { return index < active() || isDone.load(std::memory_order_relaxed); });
+  }
+
+  // Has the parked workers (and the waiting loop) look at `isDone` again.
+  // Taking the mutex makes sure none is between checking it and going to
+  // sleep.
+  void wake() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+    }
+    wakeup_.notify_all();
+  }
+
+  // Sets `isDone`, the first call remembering when.
+  void stop(std::atomic_bool &isDone) {
+    std::int64_t never = 0;
+    stoppedAt_.compare_exchange_strong(never, std::chrono::steady_clock::now().time_since_epoch().count());
+    isDone.store(true, std::memory_order_relaxed);
+    wake();
+  }
+
+  bool stopped() const { return stoppedAt_.load() != 0; }
+
+  std::chrono::steady_clock::time_point stoppedAt() const {
+    return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(stoppedAt_.load()));
+  }
+
+  // Sleeps for `timeout` or until `wake()` finds `done()`.
+  template <typename Done>
+  void wait(std::chrono::duration<double> timeout, Done &&done) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    wakeup_.wait_for(lock, timeout, done);
+  }
+
+private:
+  std::atomic<unsigned>     active_;
+  std::atomic<std::int64_t> stoppedAt_{0};  // steady_clock ticks, 0 is not yet
+  std::mutex                mutex_;
+  std::condition_variable   wakeup_;
+};
+
+// The worker count a `--threads-file` asks for, re-read when the file changes
+// or on SIGUSR2 (which also catches a rewrite within the mtime granularity).
+volatile std::sig_atomic_t threadsFileSignalled = 0;
+
+void OnThreadsFileSignal(int) {
+  threadsFileSignalled = 1;
+}
+
+// The first SIGINT or SIGTERM stops the run the regular way, so that the
+// summary and the trace still get written; the second one kills as usual.
+volatile std::sig_atomic_t stopSignalled = 0;
+
+void OnStopSignal(int) {
+  stopSignalled = 1;
+}
+
+void CatchStopSignals() {
+  stopSignalled = 0;
+  struct sigaction action {};
+  action.sa_handler = OnStopSignal;
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESETHAND | SA_RESTART;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+}
+
+class ThreadsFile {
+public:
+  explicit ThreadsFile(std::string path) : path_(std::move(path)) {
+    struct sigaction action {};
+    action.sa_handler = OnThreadsFileSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &action, nullptr);
+  }
+
+  // Whether there is a new count in `threads`.
+  bool poll(unsigned &threads) {
+    struct stat status;
+    if (stat(path_.c_str(), &status) != 0) {
+      return false;
+    }
+    bool const changed = status.st_mtim.tv_sec != modifiedAt_.tv_sec || status.st_mtim.tv_nsec != modifiedAt_.tv_nsec;
+    if (!changed && !threadsFileSignalled) {
+      return false;
+    }
+    threadsFileSignalled = 0;
+    modifiedAt_ = status.st_mtim;
+
+    std::ifstream in(path_);
+    long value = 0;
+    if (!(in >> value) || value < 0) {
+      return false;
+    }
+    threads = static_cast<unsigned>(value);
+    return true;
+  }
+
+private:
+  std::string path_;
+  timespec    modifiedAt_{};
+};
+
+// A batch on its way from the hashing to the keygen side of `--smt-split`.
+// Vectors are swapped in and out, never copied.
+struct alignas(64) HandOver {
+  std::vector<unsigned>  wordIndices;
+  std::vector<SecretKey> secretKeys;
+  std::size_t            count{0};
+};
+
+// Deep enough to ride out the jitter of the two sides, shallow enough for
+// the batches to still be in the shared L1/L2 when they are taken.
+using BatchRing = SpscRing<HandOver, 4>;
+
+// Waiting on the sibling: spin a while with `pause` (which also hands the
+// core's resources over to it), then give the CPU away.
+void Backoff(unsigned spins) {
+  if (spins < 256) {
+    _mm_pause();
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+struct Hashing {
+  // The fused loop does every stage of a batch; `--smt-split` gives the
+  // hashing to one thread and the keygen and match to another.
+  enum class Role { Fused, Hash, KeyGen };
+
+  struct Split {
+    Role           role{Role::Fused};
+    BatchRing     *ring{nullptr};
+    Hashing const *partner{nullptr};  // the other side of the ring
+    int            cpu{-1};           // to pin the thread to, -1 is not to
+  };
+
+  struct Stats {
+    std::size_t tries{0};
+    std::chrono::duration<double> elapsedTime{0};
+    PerfCounters::Sample perf;
+    bool hit{false};
+    std::vector<unsigned> passphrase;
+  };
+
+  // `scheduler` is null for the random search, else it hands out `walk`
+  // and `index` is ours in it and in `control`; `thread` is our number among
+  // all the threads (the two sides of a split share an index).
+  Hashing(Options const &options, Target const &target, KeyGenBackend const &keyGen,
+          RangeScheduler *scheduler, Walk const *walk, ThreadControl &control, unsigned index, unsigned thread,
+          std::atomic<std::uint64_t> &progress, Trace *trace, Split const &split)
+      : options_(options), target_(target), keyGen_(keyGen), hashKernel_(*FindHashKernel(options.hashKernel)),
+        nWords_(target.nWords), scheduler_(scheduler), walk_(walk), control_(control), index_(index), thread_(thread),
+        split_(split), progress_(progress), trace_(trace)
+  {}
+  Hashing(Hashing const &other) = delete;
+  Hashing(Hashing&& other)
+      : options_(other.options_), target_(other.target_), keyGen_(other.keyGen_), hashKernel_(other.hashKernel_),
+        nWords_(other.nWords_), scheduler_(other.scheduler_), walk_(other.walk_), control_(other.control_),
+        index_(other.index_),
+        thread_(other.thread_), split_(other.split_), stats_(other.stats_), handedOver_(other.handedOver_),
+        progress_(other.progress_),
+        trace_(other.trace_), finished_(other.finished_.load()), parked_(other.parked_.load())
+  {}
+
+  Stats const &stats() const { return stats_; }
+
+  // Whether the thread is over, be it a hit, a stop or the end of its work.
+  bool finished() const { return finished_.load(std::memory_order_acquire); }
+
+  // Tries so far, safe to read from another thread while running. The counter
+  // is our slot of the stats segment.
+  std::size_t progress() const { return progress_.load(std::memory_order_relaxed); }
+
+  // Whether the thread waits to be let run again. It parks between
+  // enumeration chunks only, so it holds no passphrases meanwhile.
+  bool parked() const { return parked_.load(std::memory_order_acquire); }
+
+  void operator () (std::mutex &printingMutex, std::atomic_bool &isDone) {
+    PROFILE(
+        std::chrono::duration<double> shaTime{0};
+        std::chrono::duration<double> curveTime{0};
+    )
+
+    auto const markFinished = gsl::finally([this] {
+      finished_.store(true, std::memory_order_release);
+      control_.wake();
+    });
+
+    if (split_.cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(split_.cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+    }
+
+    std::random_device              rd;
+    std::default_random_engine      gen(rd());
+    std::uniform_int_distribution<> dis(0, DictSize - 1);
+
+    // The enumeration is where we are in the chunk at hand.
+    Odometer              odometer(nWords_);
+    RangeScheduler::Range chunk;
+    bool                  exhausted = false;
+    bool                  parking   = false;
+
+    // Where the last batch ran, to tell migrations in the trace.
+    std::uint32_t cpu = trace_ ? static_cast<std::uint32_t>(sched_getcpu()) : 0;
+
+    // Candidates go through the keygen in batches, so that batched backends
+    // can share the work; `lane` is the one of the batch that gets reported.
+    std::size_t const      batch = options_.batch ? options_.batch : DefaultBatch;
+    std::vector<unsigned>  batchWordIndices(batch * nWords_);
+    std::vector<SecretKey> secretKeys(batch);
+    std::vector<PublicKey> publicKeys(batch);
+    std::size_t            lane = 0;
+
+    bool      hit = false;
+    auto const &publicKeyReference = target_.publicKey;
+
+    // Counters are per thread, so they have to be opened right here.
+    std::unique_ptr<PerfCounters> perfCounters;
+    if (options_.perfCounters) {
+      perfCounters = std::make_unique<PerfCounters>();
+      perfCounters->start();
+    }
+
+    // Under `--stop-latency-ms` the keygen of a batch goes in pieces that take
+    // no longer than that, by what the keys took so far.
+    auto const  stopLatency   = std::chrono::duration<double>(options_.stopLatency);
+    double      secondsPerKey = 0;
+    bool        cancelled     = false;
+
+    // Parked time is left out of the rate the chunks are sized by.
+    auto const startedAt  = std::chrono::steady_clock::now();
+    auto       runningSince = startedAt;
+    for (; !isDone.load(std::memory_order_relaxed); ) {
+      // The progress, the checkpoint claim and the parking are seen to every
+      // 128 candidates (or every batch, if bigger). A stop is looked at
+      // between the stages of every batch: those are the cancellation points.
+      for (std::size_t hadmadeLoop__ = 0; hadmadeLoop__ < 128 && !hit && !exhausted && !parking && !cancelled;
+           hadmadeLoop__ += batch) {
+        // Obtain the SHA256 hashes of a batch of random passphrases, or of the
+        // next ones in order; the last batch of an enumeration may come short.
+        PROFILE(auto const shaAt = std::chrono::steady_clock::now());
+        std::uint64_t const batchAt = trace_ ? trace_->now() : 0;
+        std::size_t   count     = batch;
+        std::uint64_t shaDoneAt = batchAt;
+        if (split_.role == Role::KeyGen) {
+          // The other side pushes before it parks or finishes, so the ring is
+          // looked at once more after seeing it did.
+          HandOver *slot = nullptr;
+          for (unsigned spins = 0; !(slot = split_.ring->front()); ++spins) {
+            bool const partnerFinished = split_.partner->finished();
+            bool const partnerParked   = split_.partner->parked();
+            if (partnerFinished || partnerParked || isDone.load(std::memory_order_relaxed)) {
+              if (!(slot = split_.ring->front())) {
+                exhausted = partnerFinished;
+                parking   = partnerParked && !partnerFinished;
+              }
+              break;
+            }
+            Backoff(spins);
+          }
+          if (!slot) {
+            break;
+          }
+          std::swap(slot->wordIndices, batchWordIndices);
+          std::swap(slot->secretKeys, secretKeys);
+          count = slot->count;
+          split_.ring->pop();
+        } else {
+          if (!scheduler_) {
+            for (auto &wordIndex : batchWordIndices) {
+              wordIndex = dis(gen);
+            }
+          } else {
+            // Told to step aside halfway through a chunk, we give the rest
+            // of it back rather than have the parking wait for it.
+            if (chunk.begin != chunk.end && index_ >= control_.active()) {
+              scheduler_->giveBack(index_, chunk.begin, chunk.end);
+              chunk.begin = chunk.end;
+              parking = true;
+              break;
+            }
+            for (count = 0; count < batch; ++count) {
+              if (chunk.begin == chunk.end) {
+                // The next chunk waits for this batch to be checked, so that
+                // the scheduler knows what is done (see `done()`).
+                if (count > 0) {
+                  break;
+                }
+                if (index_ >= control_.active()) {
+                  parking = true;
+                  break;
+                }
+                if (!scheduler_->take(index_, chunkSize(runningSince), chunk)) {
+                  exhausted = true;
+                  break;
+                }
+                if (trace_) {
+                  auto const takenAt = trace_->now();
+                  if (chunk.stolenFrom != RangeScheduler::NotStolen) {
+                    trace_->ring(thread_).record(TraceRing::Kind::Steal, takenAt, takenAt, chunk.stolenFrom, cpu);
+                  }
+                  trace_->ring(thread_).record(TraceRing::Kind::Chunk, takenAt, takenAt, chunk.end - chunk.begin, cpu);
+                }
+              }
+              odometer.set(walk_->index(chunk.begin));
+              std::copy(odometer.digits(), odometer.digits() + nWords_, &batchWordIndices[count * nWords_]);
+              ++chunk.begin;
+            }
+            if (count == 0) {
+              break;
+            }
+          }
+          hashKernel_.hash(secretKeys.data(), batchWordIndices.data(), nWords_, count);
+          PROFILE(shaTime += std::chrono::steady_clock::now() - shaAt);
+          shaDoneAt = trace_ ? trace_->now() : 0;
+        }
+
+        if (split_.role == Role::Hash) {
+          HandOver *slot = nullptr;
+          for (unsigned spins = 0; !(slot = split_.ring->back()) && !isDone.load(std::memory_order_relaxed); ++spins) {
+            Backoff(spins);
+          }
+          if (!slot) {
+            break;
+          }
+          std::swap(slot->wordIndices, batchWordIndices);
+          std::swap(slot->secretKeys, secretKeys);
+          slot->count = count;
+          split_.ring->push();
+          handedOver_ += count;
+          if (trace_) {
+            trace_->ring(thread_).record(TraceRing::Kind::Sha256, batchAt, shaDoneAt, count, cpu);
+          }
+          continue;
+        }
+
+        // We've got the keys in `secretKeys`, which are used in X25519 hashing algorithm
+        // as the private keys.
+        // The next we do is obtaining the public keys, unless told to stop
+        // meanwhile, in as many calls as the stop latency wants.
+
+        PROFILE(auto const curveAt = std::chrono::steady_clock::now());
+        std::size_t generated = 0;
+        while (generated < count && !(cancelled = isDone.load(std::memory_order_relaxed))) {
+          std::size_t piece = count - generated;
+          if (stopLatency > stopLatency.zero() && secondsPerKey > 0) {
+            piece = std::min(piece, std::max<std::size_t>(1, static_cast<std::size_t>(stopLatency.count() / secondsPerKey)));
+          }
+          auto const pieceAt = stopLatency > stopLatency.zero() ? std::chrono::steady_clock::now()
+                                                                : std::chrono::steady_clock::time_point();
+          keyGen_.generate(&publicKeys[generated], &secretKeys[generated], piece);
+          if (stopLatency > stopLatency.zero()) {
+            double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pieceAt).count() / piece;
+            secondsPerKey = secondsPerKey > 0 ? 0.9 * secondsPerKey + 0.1 * seconds : seconds;
+          }
+          generated += piece;
+        }
+        PROFILE(curveTime += std::chrono::steady_clock::now() - curveAt);
+        std::uint64_t const curveDoneAt = trace_ ? trace_->now() : 0;
+
+        // What was not generated goes back to the chunk, for the checkpoint
+        // not to count it done.
+        if (generated < count && scheduler_ && split_.role == Role::Fused) {
+          chunk.begin -= count - generated;
+        }
+
+        // As promised, `publicKeys` contains the public keys now, and
+        // it is time to check if we have found the collision!
+        // If so, mark our mission done and run away from the loops.
+        for (lane = 0; lane < generated; ++lane) {
+          // Let's call it a nice try.
+          ++stats_.tries;
+          if (publicKeys[lane] == publicKeyReference) {
+            // A hit of a variable-time backend is only a lead: it stops the
+            // run once the constant-time keygen agrees, else we go on.
+            PublicKey publicKey;
+            if (!keyGen_.constantTime) {
+              ConstantTimeKeyGen().generate(&publicKey, &secretKeys[lane], 1);
+            }
+            if (keyGen_.constantTime || publicKey == publicKeyReference) {
+              hit = true;
+              control_.stop(isDone);
+              break;
+            }
+            std::vector<unsigned> const candidate(&batchWordIndices[lane * nWords_],
+                                                  &batchWordIndices[(lane + 1) * nWords_]);
+            std::lock_guard<std::mutex> printingLock(printingMutex);
+            std::cerr << "Warning: the " << keyGen_.name << " hit on \"" << PassphraseString(candidate)
+                      << "\" does not hold up under " << ConstantTimeKeyGen().name << ", searching on\n";
+          }
+        }
+        if (!hit) {
+          lane = generated ? generated - 1 : 0;
+        }
+
+        if (trace_) {
+          auto &ring = trace_->ring(thread_);
+          auto const now = static_cast<std::uint32_t>(sched_getcpu());
+          if (now != cpu) {
+            ring.record(TraceRing::Kind::Migration, batchAt, batchAt, cpu, now);
+          }
+          cpu = now;
+          ring.record(TraceRing::Kind::Batch, batchAt, trace_->now(), count, cpu);
+          if (split_.role == Role::Fused) {
+            ring.record(TraceRing::Kind::Sha256, batchAt, shaDoneAt, count, cpu);
+          }
+          ring.record(TraceRing::Kind::X25519, shaDoneAt, curveDoneAt, count, cpu);
+        }
+      }
+
+      progress_.store(stats_.tries, std::memory_order_relaxed);
+      // All that came out of the chunk is checked; the split checks it on the
+      // other side of the ring, so it can't tell (and takes no checkpoints).
+      if (scheduler_ && split_.role == Role::Fused) {
+        scheduler_->done(index_, chunk.begin);
+      }
+
+      if (hit) {
+        break;
+      }
+      if (exhausted) {
+        break;
+      }
+
+      // Told to step aside: the random search may just stop anywhere, the
+      // enumeration has finished its chunk above. The keygen side of a split
+      // follows its hashing side once the ring is empty.
+      if (parking || (!scheduler_ && split_.role != Role::KeyGen && index_ >= control_.active())) {
+        parked_.store(true, std::memory_order_release);
+        auto const parkedAt = std::chrono::steady_clock::now();
+        std::uint64_t const traceParkedAt = trace_ ? trace_->now() : 0;
+        control_.park(index_, isDone);
+        runningSince += std::chrono::steady_clock::now() - parkedAt;
+        if (trace_) {
+          trace_->ring(thread_).record(TraceRing::Kind::Parked, traceParkedAt, trace_->now(), control_.active(), cpu);
+        }
+        parked_.store(false, std::memory_order_release);
+        parking = false;
+      }
+    }
+
+    {
+      stats_.elapsedTime = std::chrono::steady_clock::now() - startedAt;
+      if (perfCounters) {
+        perfCounters->stop();
+        stats_.perf = perfCounters->read();
+      }
+      unsigned const *wordIndices = &batchWordIndices[lane * nWords_];
+      if (hit) {
+        stats_.hit = true;
+        stats_.passphrase.assign(wordIndices, wordIndices + nWords_);
+      }
+      if (!options_.verbose || split_.role == Role::Hash) {
+        return;
+      }
+
+      auto const speed = static_cast<double>(stats_.tries) / stats_.elapsedTime.count();
+      std::vector<std::string> passphraseWords;
+      std::transform(wordIndices, wordIndices + nWords_,
+                     std::back_inserter(passphraseWords),
+                     [](auto i) -> std::string {
+                       return gsl::to_string(Words[i]);
+                     });
+      std::string const passphrase = join(passphraseWords, ' ');
+
+      // Lock the mutex to prevent threads from messing stdout. A hit is not
+      // shown here: `Run()` does once it holds up under the constant-time
+      // keygen.
+      std::lock_guard<std::mutex> printingLock(printingMutex);
+      if (!hit) {
+        std::cout << (SMITE SMITE SMITE SMITE SMITE SMITE SMITE SMITE SMITE SMITE) << '\n';
+      }
+      std::cout << "took " << stats_.elapsedTime.count() << " s"
+                PROFILE(<< "\tsha256-ing  "     << shaTime.count() << " s")
+                PROFILE(<< "\tcurve25519-ing  " << curveTime.count() << " s") << '\n'
+                << "speed: " << speed << " tries/s per thread\n"
+                << "tries: " << stats_.tries << '\n';
+      if (!hit) {
+        std::cout << "passphrase: " << passphrase << '\n'
+                  << "secret key (sha256):  " << to_hexstring(secretKeys[lane]) << '\n'
+                  << "public key:           " << to_hexstring(publicKeys[lane]) << '\n'
+                  << "reference public key: " << to_hexstring(publicKeyReference) << '\n';
+      }
+      if (perfCounters) {
+        std::cout << "perf: ";
+        PrintPerfSample(std::cout, stats_.perf, stats_.tries);
+        std::cout << '\n';
+      }
+    }
+  }
+
+ private:
+  // The next enumeration chunk to ask for, from our rate so far. The hashing
+  // side of a split tries nothing itself and goes by what it handed over,
+  // which the ring holds to the pace of its keygen side.
+  std::uint64_t chunkSize(std::chrono::steady_clock::time_point runningSince) const {
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - runningSince;
+    auto const tries = split_.role == Role::Hash ? handedOver_ : stats_.tries;
+    if (tries == 0 || elapsed <= elapsed.zero()) {
+      return FirstChunk;
+    }
+    auto const rate = static_cast<double>(tries) / elapsed.count();
+    return std::max(FirstChunk, static_cast<std::uint64_t>(rate * TargetChunkTime.count()));
+  }
+
+  Options const       &options_;
+  Target const        &target_;
+  KeyGenBackend const &keyGen_;
+  HashKernel const    &hashKernel_;
+  unsigned             nWords_;
+  RangeScheduler      *scheduler_;
+  Walk const          *walk_;
+  ThreadControl       &control_;
+  unsigned             index_;
+  unsigned             thread_;
+  Split                split_;
+  Stats                stats_;
+  std::uint64_t        handedOver_{0};  // to the keygen side of a split
+
+  std::atomic<std::uint64_t> &progress_;
+  Trace                      *trace_;  // null when not tracing
+  std::atomic_bool            finished_{false};
+  std::atomic_bool            parked_{false};
+};
+
+}  // namespace
+
+RunResult Run(Options const &options, Target const &target, std::chrono::duration<double> timeout,
+              CampaignSlot *campaign) {
+  auto const *keyGen = FindKeyGenBackend(options.curveBackend);
+  Expects(keyGen != nullptr);
+  auto const *hashKernel = FindHashKernel(options.hashKernel);
+  Expects(hashKernel != nullptr);
+
+  // As many threads as the cgroup lets run at once, unless told otherwise;
+  // more of them are started parked for the `--threads-file` (or the
+  // campaign) to grow into. With `--smt-split` a worker is a pair of threads,
+  // and the counts that control the pool are of pairs.
+  CpuBudget const budget = ReadCpuBudget();
+  unsigned const  threadsPerWorker = options.smtSplit ? 2 : 1;
+  unsigned const  nActive  = campaign ? campaign->threads.load()
+                           : std::max(1u, (options.threads ? options.threads : budget.threads()) / threadsPerWorker);
+  unsigned const  nWorkers = options.threadsFile.empty() && !campaign
+                           ? nActive : std::max({1u, nActive, budget.cpus() / threadsPerWorker});
+  unsigned const  nThreads = nWorkers * threadsPerWorker;
+  char const     *workerUnit = options.smtSplit ? " pairs" : " threads";
+  if (options.verbose) {
+    std::cout << "Concurrency: " << budget.hardware << " vCPUs; affinity " << budget.affinity << "; ";
+    if (budget.quota > 0) {
+      std::cout << "cgroup quota " << budget.quota << " CPUs (" << budget.quotaPath << "); ";
+    } else {
+      std::cout << "no cgroup quota; ";
+    }
+    std::cout << "running " << nActive << " of " << nWorkers << workerUnit << '\n'
+              << "Curve backend: " << keyGen->name << "; hash kernel: "
+              << HashKernelName(*hashKernel, target.nWords) << '\n';
+    if (keyGen->generate == X25519KeyGenVartime) {
+      auto const &table = SharedFixedBaseTable();
+      std::cout << "Fixed-base table: w=" << table.windowBits() << ", " << table.size() / 1024
+                << " KB, " << table.backing() << " pages\n";
+    }
+  }
+
+  std::mutex       printingMutex;
+  std::atomic_bool isDone{false};
+  ThreadControl    control(nActive);
+
+  std::unique_ptr<ThreadsFile> threadsFile;
+  if (!options.threadsFile.empty()) {
+    threadsFile = std::make_unique<ThreadsFile>(options.threadsFile);
+  }
+
+  // The enumeration walks the keyspace (or its shard, or what a checkpoint
+  // left of it) once, shared out by the scheduler.
+  std::unique_ptr<Walk>           walk;
+  std::unique_ptr<RangeScheduler> scheduler;
+  Checkpoint                      checkpoint;
+  if (options.enumerate) {
+    Expects(target.nWords <= MaxEnumerateWords);
+    Expects(options.shardIndex < options.shardCount);
+    std::uint64_t keyspace = 1;
+    for (unsigned i = 0; i < target.nWords; ++i) {
+      keyspace *= DictSize;
+    }
+
+    checkpoint.nWords     = target.nWords;
+    checkpoint.permute    = options.permute;
+    checkpoint.key        = options.permutationKey;
+    checkpoint.shardIndex = options.shardIndex;
+    checkpoint.shardCount = options.shardCount;
+    auto const shardBound = [&](unsigned shard) {
+      return keyspace / options.shardCount * shard + keyspace % options.shardCount * shard / options.shardCount;
+    };
+    checkpoint.pending = {{shardBound(options.shardIndex), shardBound(options.shardIndex + 1)}};
+
+    bool resumed = false;
+    if (!options.checkpointPath.empty()) {
+      Checkpoint loaded;
+      if (!LoadCheckpoint(options.checkpointPath, keyspace, loaded, resumed)) {
+        RunResult result;
+        result.failed = true;
+        return result;
+      }
+      if (resumed && (loaded.nWords != checkpoint.nWords || loaded.permute != checkpoint.permute
+                      || loaded.key != checkpoint.key || loaded.shardIndex != checkpoint.shardIndex
+                      || loaded.shardCount != checkpoint.shardCount)) {
+        std::cerr << "The checkpoint " << options.checkpointPath << " is of " << loaded.nWords << " words, "
+                  << (loaded.permute ? "permuted with key " + std::to_string(loaded.key) : "in order")
+                  << ", shard " << loaded.shardIndex << '/' << loaded.shardCount << "; not this run\n";
+        RunResult result;
+        result.failed = true;
+        return result;
+      }
+      if (resumed) {
+        checkpoint.pending = std::move(loaded.pending);
+      }
+    }
+
+    walk      = std::make_unique<Walk>(checkpoint.pending, keyspace, options.permute, options.permutationKey);
+    scheduler = std::make_unique<RangeScheduler>(walk->size(), nWorkers);
+    if (campaign) {
+      campaign->size.store(walk->size());
+    }
+    if (options.verbose) {
+      std::cout << "Enumerating " << walk->size() << " of " << keyspace << " passphrases";
+      if (options.permute) {
+        std::cout << " in the order of permutation key " << options.permutationKey;
+      }
+      if (options.shardCount > 1) {
+        std::cout << "; shard " << options.shardIndex << '/' << options.shardCount;
+      }
+      if (resumed) {
+        std::cout << "; resuming " << options.checkpointPath;
+      }
+      std::cout << '\n';
+    }
+  }
+
+  // Pending is what is left in the scheduler in its terms; the checkpoint
+  // wants it in positions.
+  auto const saveCheckpoint = [&] {
+    checkpoint.pending.clear();
+    for (auto const &range : scheduler->pending()) {
+      walk->positions(range.begin, range.end, checkpoint.pending);
+    }
+    CoalesceRanges(checkpoint.pending);
+    SaveCheckpoint(options.checkpointPath, checkpoint);
+  };
+
+  StatsSegment stats(options.statsName,
+                     {nThreads, target.nWords, scheduler ? scheduler->size() : 0,
+                      keyGen->name, HashKernelName(*hashKernel, target.nWords)});
+  if (options.verbose && !stats.path().empty()) {
+    std::cout << "Publishing stats to " << stats.path() << '\n';
+  }
+
+  std::unique_ptr<Trace> trace;
+  if (!options.tracePath.empty()) {
+    trace = std::make_unique<Trace>(options.tracePath, nThreads);
+  }
+  // The trace and the checkpoints are worth a clean stop.
+  if (trace || campaign || !options.checkpointPath.empty()) {
+    CatchStopSignals();
+  }
+
+  // Workers outlive their threads so that we can sum their stats up at the end.
+  std::vector<Hashing> workers;
+  workers.reserve(nThreads);
+  std::vector<std::unique_ptr<BatchRing>> rings;
+  if (!options.smtSplit) {
+    auto const cpus = options.pinThreads ? AffinityCpus() : std::vector<unsigned>();
+    for (unsigned i = 0; i < nWorkers; ++i) {
+      Hashing::Split fused;
+      if (!cpus.empty()) {
+        fused.cpu = static_cast<int>(cpus[i % cpus.size()]);
+      }
+      workers.emplace_back(options, target, *keyGen, scheduler.get(), walk.get(), control, i, i, stats.threadTries(i),
+                           trace.get(), fused);
+    }
+  } else {
+    // The two sides of a pair go on the hyperthreads of one core, as long as
+    // there are cores with two of them in our affinity mask.
+    std::vector<std::vector<unsigned>> smtCores;
+    for (auto const &core : CoreSiblings()) {
+      if (core.size() >= 2) {
+        smtCores.push_back(core);
+      }
+    }
+    std::size_t const batch = options.batch ? options.batch : DefaultBatch;
+    HandOver const    prototype{std::vector<unsigned>(batch * target.nWords), std::vector<SecretKey>(batch), 0};
+    for (unsigned i = 0; i < nWorkers; ++i) {
+      rings.push_back(std::make_unique<BatchRing>(prototype));
+      int const hashCpu   = i < smtCores.size() ? static_cast<int>(smtCores[i][0]) : -1;
+      int const keyGenCpu = i < smtCores.size() ? static_cast<int>(smtCores[i][1]) : -1;
+      workers.emplace_back(options, target, *keyGen, scheduler.get(), walk.get(), control, i, 2 * i,
+                           stats.threadTries(2 * i), trace.get(),
+                           Hashing::Split{Hashing::Role::Hash, rings[i].get(), nullptr, hashCpu});
+      workers.emplace_back(options, target, *keyGen, scheduler.get(), walk.get(), control, i, 2 * i + 1,
+                           stats.threadTries(2 * i + 1), trace.get(),
+                           Hashing::Split{Hashing::Role::KeyGen, rings[i].get(), &workers[2 * i], keyGenCpu});
+    }
+    if (options.verbose) {
+      std::cout << "SMT split: " << std::min<std::size_t>(nWorkers, smtCores.size()) << " of " << nWorkers
+                << " hashing/keygen pairs pinned to sibling hyperthreads\n";
+    }
+  }
+
+  std::forward_list<std::thread> threads;
+  for (auto &worker : workers) {
+    threads.emplace_front(std::ref(worker), std::ref(printingMutex), std::ref(isDone));
+  }
+
+  // Keep an eye on the workers and tell how they are doing now and then.
+  Rapl       rapl;
+  auto const startedAt  = std::chrono::steady_clock::now();
+  auto       reportedAt = startedAt;
+  auto       savedAt    = startedAt;
+  std::size_t reportedTries = 0;
+  double      reportedJoules = 0;
+
+  // The published rate is over the last second or so, whatever `--report` is.
+  auto        rateAt    = startedAt;
+  std::size_t rateTries = 0;
+  double      rate      = 0;
+  auto const publish = [&](StatsSegment::State state, std::chrono::steady_clock::time_point now) {
+    std::size_t tries = 0;
+    for (auto const &worker : workers) {
+      tries += worker.progress();
+    }
+    if (now - rateAt >= std::chrono::seconds(1)) {
+      rate      = static_cast<double>(tries - rateTries) / std::chrono::duration<double>(now - rateAt).count();
+      rateAt    = now;
+      rateTries = tries;
+    }
+    stats.publish({state, control.active(), std::chrono::duration<double>(now - startedAt).count(), rate,
+                   tries, scheduler ? scheduler->size() - scheduler->remaining() : 0});
+    if (campaign) {
+      campaign->tries.store(tries);
+      campaign->rate.store(rate);
+      campaign->active.store(control.active());
+    }
+  };
+  // Parked workers hold no passphrases, so once none are left to hand out
+  // they have nothing to come back for.
+  auto const allFinished = [&workers, &scheduler] {
+    return std::all_of(workers.cbegin(), workers.cend(), [&scheduler](auto const &worker) {
+      return worker.finished() || (scheduler && worker.parked() && scheduler->remaining() == 0);
+    });
+  };
+  auto const stopping = [&isDone, &allFinished] { return isDone.load(std::memory_order_relaxed) || allFinished(); };
+  while (!stopping()) {
+    control.wait(std::chrono::milliseconds(100), stopping);
+    if (isDone.load(std::memory_order_relaxed)) {
+      break;
+    }
+    rapl.sample();
+
+    auto const now = std::chrono::steady_clock::now();
+    if (timeout > timeout.zero() && now - startedAt >= timeout) {
+      break;
+    }
+    if (stopSignalled) {
+      if (options.verbose) {
+        std::lock_guard<std::mutex> printingLock(printingMutex);
+        std::cout << "Stopping on a signal\n";
+      }
+      break;
+    }
+
+    unsigned wanted = control.active();
+    if (campaign) {
+      wanted = campaign->threads.load();
+    } else if (threadsFile) {
+      threadsFile->poll(wanted);
+    }
+    if (std::min(wanted, nWorkers) != control.active()) {
+      control.setActive(std::min(wanted, nWorkers));
+      if (options.verbose) {
+        std::lock_guard<std::mutex> printingLock(printingMutex);
+        std::cout << "Running " << control.active() << " of " << nWorkers << workerUnit << '\n';
+      }
+    }
+    publish(StatsSegment::State::Running, now);
+    if (!options.checkpointPath.empty() && now - savedAt >= CheckpointInterval) {
+      saveCheckpoint();
+      savedAt = now;
+    }
+
+    if (options.reportInterval <= 0
+        || now - reportedAt < std::chrono::duration<double>(options.reportInterval)) {
+      continue;
+    }
+
+    std::size_t tries = 0;
+    for (auto const &worker : workers) {
+      tries += worker.progress();
+    }
+    std::chrono::duration<double> const sinceStart = now - startedAt;
+    std::chrono::duration<double> const interval   = now - reportedAt;
+    double const joules = rapl.joules();
+
+    std::lock_guard<std::mutex> printingLock(printingMutex);
+    std::cout << '[' << sinceStart.count() << " s] "
+              << static_cast<double>(tries - reportedTries) / interval.count() << " tries/s";
+    if (rapl.available()) {
+      std::cout << "; " << (joules - reportedJoules) / interval.count() << " W; "
+                << static_cast<double>(tries - reportedTries) / (joules - reportedJoules) << " tries/J";
+    }
+    std::cout << "; " << tries << " tries total; " << control.active() << workerUnit << std::endl;
+
+    reportedAt     = now;
+    reportedTries  = tries;
+    reportedJoules = joules;
+  }
+
+  // A hit has stopped the run already, a timeout or a signal stops it here.
+  // At the end of the enumeration there is nobody left to stop.
+  if (!allFinished()) {
+    control.stop(isDone);
+  }
+  isDone.store(true, std::memory_order_relaxed);
+  control.wake();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto const joinedAt = std::chrono::steady_clock::now();
+  rapl.sample();
+
+  if (!options.checkpointPath.empty()) {
+    saveCheckpoint();
+    if (options.verbose) {
+      std::uint64_t left = 0;
+      for (auto const &range : checkpoint.pending) {
+        left += range.second - range.first;
+      }
+      std::cout << "Checkpoint: " << left << " passphrases left, written to " << options.checkpointPath << '\n';
+    }
+  }
+
+  if (trace && trace->write() && options.verbose) {
+    std::cout << "Trace: " << trace->events() << " events";
+    if (trace->dropped()) {
+      std::cout << " (the " << trace->dropped() << " oldest dropped)";
+    }
+    std::cout << " written to " << trace->path() << '\n';
+  }
+
+  RunResult            result;
+  if (control.stopped()) {
+    result.stopLatency = joinedAt - control.stoppedAt();
+  }
+  PerfCounters::Sample perf;
+  for (auto const &worker : workers) {
+    result.tries      += worker.stats().tries;
+    result.elapsedTime = std::max(result.elapsedTime, worker.stats().elapsedTime);
+    perf              += worker.stats().perf;
+    if (worker.stats().hit) {
+      result.hit        = true;
+      result.passphrase = worker.stats().passphrase;
+    }
+  }
+  // Every passphrase got tried, whoever did it: nothing stopped the workers
+  // before they ran out (parked workers never run out). The tries may be
+  // more than the keyspace, by what parking workers gave back with its unit.
+  result.exhausted = scheduler && !result.hit && !control.stopped() && scheduler->remaining() == 0;
+
+  // The workers checked the hit with the constant-time keygen already; the
+  // key shown is derived once more from the passphrase the slow way, and a
+  // mismatch is a broken kernel, not a hit.
+  SecretKey hitSecretKey{};
+  PublicKey hitPublicKey{};
+  if (result.hit) {
+    HashPassphrase(result.passphrase.data(), target.nWords, hitSecretKey);
+    ConstantTimeKeyGen().generate(&hitPublicKey, &hitSecretKey, 1);
+    if (hitPublicKey != target.publicKey) {
+      std::cerr << "Error: the hit on \"" << PassphraseString(result.passphrase) << "\" does not hold up under "
+                << "the scalar SHA-256 and " << ConstantTimeKeyGen().name << "; a kernel is broken\n";
+      result.hit    = false;
+      result.failed = true;
+      result.passphrase.clear();
+    }
+  }
+
+  publish(result.hit ? StatsSegment::State::Hit
+                     : result.exhausted ? StatsSegment::State::Exhausted : StatsSegment::State::Stopped,
+          std::chrono::steady_clock::now());
+
+  if (!options.verbose) {
+    return result;
+  }
+
+  auto const tries       = result.tries;
+  auto const elapsedTime = result.elapsedTime;
+
+  if (result.hit) {
+    std::cout << (SMILE SMILE SMILE SMILE SMILE SMILE SMILE SMILE SMILE SMILE) << '\n'
+              << "passphrase: " << PassphraseString(result.passphrase) << '\n'
+              << "secret key (sha256):  " << to_hexstring(hitSecretKey) << '\n'
+              << "public key:           " << to_hexstring(hitPublicKey) << '\n'
+              << "reference public key: " << to_hexstring(target.publicKey) << '\n';
+  }
+
+  if (control.stopped()) {
+    std::cout << "stop: " << result.stopLatency.count() * 1e3 << " ms from the " << (result.hit ? "hit" : "stop")
+              << " to " << nThreads << " threads joined";
+    if (options.stopLatency > 0) {
+      std::cout << " (bound " << options.stopLatency * 1e3 << " ms per worker"
+                << (result.stopLatency.count() > options.stopLatency ? ", over it" : "") << ')';
+    }
+    std::cout << '\n';
+  }
+  std::cout << "total: " << tries << " tries in " << elapsedTime.count() << " s; "
+            << static_cast<double>(tries) / elapsedTime.count() << " tries/s\n";
+  if (scheduler) {
+    std::cout << "enumeration: " << (result.hit ? "hit" : result.exhausted ? "keyspace exhausted" : "stopped") << "; "
+              << scheduler->remaining() << " passphrases never handed out; "
+              << scheduler->steals() << " steals\n";
+  }
+  if (options.perfCounters) {
+    std::cout << "total perf: ";
+    PrintPerfSample(std::cout, perf, tries);
+    std::cout << '\n';
+  }
+  if (rapl.available()) {
+    double const joules = rapl.joules();
+    std::chrono::duration<double> const wallTime = std::chrono::steady_clock::now() - startedAt;
+    std::cout << "energy: " << joules << " J package; "
+              << joules / wallTime.count() << " W average; "
+              << static_cast<double>(tries) / joules << " tries/J\n";
+  } else {
+    std::cout << "energy: n/a (no readable /sys/class/powercap/intel-rapl:*)\n";
+  }
+
+  return result;
+}
+
+std::string PassphraseString(std::vector<unsigned> const &wordIndices) {
+  std::vector<std::string> words;
+  std::transform(wordIndices.cbegin(), wordIndices.cend(),
+                 std::back_inserter(words),
+                 [](auto i) -> std::string {
+                   return gsl::to_string(Words[i]);
+                 });
+  return join(words, ' ');
+}
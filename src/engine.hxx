@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "main.hxx"
+#include "options.hxx"
+
+// What we are looking for: the public key of an `nWords`-word passphrase.
+struct Target {
+  unsigned  nWords;
+  PublicKey publicKey;
+};
+
+struct RunResult {
+  bool                          hit{false};
+  bool                          exhausted{false};  // the enumeration went through it all
+  bool                          failed{false};     // never got going, e.g. on another run's checkpoint
+  std::vector<unsigned>         passphrase;  // word indices of the hit
+  std::size_t                   tries{0};
+  std::chrono::duration<double> elapsedTime{0};
+  std::chrono::duration<double> stopLatency{0};  // from the hit or stop to all threads joined
+};
+
+// The most words `--enumerate` takes: DictSize^5 still fits 64 bits.
+unsigned const MaxEnumerateWords = 5;
+
+// The most keys `--batch` puts in a keygen call; the workers hold a few
+// vectors of that many.
+std::size_t const MaxKeyBatch = 4096;
+
+// A run's seat in a `--campaign`: the campaign sets how many workers it is to
+// run (0 parks them all), the run tells how it is doing.
+struct CampaignSlot {
+  std::atomic<unsigned>      threads{0};
+  std::atomic<std::uint64_t> size{0};    // passphrases of the enumeration, 0 for the random search
+  std::atomic<std::uint64_t> tries{0};
+  std::atomic<double>        rate{0};    // tries/s over the last second or so
+  std::atomic<unsigned>      active{0};  // workers running now
+};
+
+// Runs the search for `target` on all the workers until one of them hits or
+// `timeout` passes (zero means no timeout). With `options.enumerate` the
+// passphrases are walked in order (or in the keyed random one of
+// `options.permute`) rather than drawn at random, and the run also ends once
+// all of them are done. In a `campaign`, its slot sets the worker count the
+// way a `--threads-file` would.
+RunResult Run(Options const &options, Target const &target,
+              std::chrono::duration<double> timeout = std::chrono::duration<double>::zero(),
+              CampaignSlot *campaign = nullptr);
+
+// The SHA-256 of the passphrase made of `nWords` words, the way the engine
+// hashes it.
+void HashPassphrase(unsigned const *wordIndices, unsigned nWords, SecretKey &secretKey);
+
+// Joins the words of the passphrase with the whitespace.
+std::string PassphraseString(std::vector<unsigned> const &wordIndices);
@@ -0,0 +1,302 @@
+#include "fixedbase.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <gsl/gsl>
+#include <sys/mman.h>
+
+extern "C" {
+#include <fp25519_x64.h>
+}
+
+namespace {
+
+// Field elements are 4 x 64-bit limbs, kept below 2^256 but not fully reduced
+// until the very end.
+using Fe = EltFp25519_1w_x64;
+
+// The rfc7748 field functions take non-const pointers to their inputs too.
+inline std::uint64_t *Mutable(std::uint64_t const *a) { return const_cast<std::uint64_t *>(a); }
+
+inline void FeMul(std::uint64_t *c, std::uint64_t const *a, std::uint64_t const *b) {
+  EltFp25519_1w_Buffer_x64 buffer_1w;
+  mul_EltFp25519_1w_x64(c, Mutable(a), Mutable(b));
+}
+
+inline void FeAdd(std::uint64_t *c, std::uint64_t const *a, std::uint64_t const *b) {
+  add_EltFp25519_1w_x64(c, Mutable(a), Mutable(b));
+}
+
+inline void FeSub(std::uint64_t *c, std::uint64_t const *a, std::uint64_t const *b) {
+  sub_EltFp25519_1w_x64(c, Mutable(a), Mutable(b));
+}
+
+// 2d, where d = -121665/121666 is the Edwards curve constant.
+Fe const D2 = {0xebd69b9426b2f159, 0x00e0149a8283b156, 0x198e80f2eef3d130, 0x2406d9dc56dffce7};
+
+// The Edwards base point, the one that maps to u = 9.
+Fe const BaseX = {0xc9562d608f25d51a, 0x692cc7609525a7b2, 0xc0a4e231fdd6dc5c, 0x216936d3cd6e53fe};
+Fe const BaseY = {0x6666666666666658, 0x6666666666666666, 0x6666666666666666, 0x6666666666666666};
+
+// Extended coordinates: x = X/Z, y = Y/Z, xy = T/Z.
+struct Point {
+  Fe X, Y, Z, T;
+};
+
+// An affine point the way the mixed addition wants it.
+struct Niels {
+  Fe yPlusX, yMinusX, xy2d;
+};
+
+std::size_t const HugePageSize = std::size_t{2} << 20;
+
+std::size_t RoundUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+Point Identity() {
+  Point p{};
+  p.Y[0] = 1;
+  p.Z[0] = 1;
+  return p;
+}
+
+// r = p + q. The formula is complete on this curve, so it doubles and adds
+// the identity just fine. `r` may alias the arguments.
+void Add(Point &r, Point const &p, Point const &q) {
+  Fe a, b, c, d, e, f, g, h, t;
+  FeSub(a, p.Y, p.X);
+  FeSub(t, q.Y, q.X);
+  FeMul(a, a, t);
+  FeAdd(b, p.Y, p.X);
+  FeAdd(t, q.Y, q.X);
+  FeMul(b, b, t);
+  FeMul(c, p.T, q.T);
+  FeMul(c, c, D2);
+  FeMul(d, p.Z, q.Z);
+  FeAdd(d, d, d);
+
+  FeSub(e, b, a);
+  FeSub(f, d, c);
+  FeAdd(g, d, c);
+  FeAdd(h, b, a);
+  FeMul(r.X, e, f);
+  FeMul(r.Y, g, h);
+  FeMul(r.T, e, h);
+  FeMul(r.Z, f, g);
+}
+
+// r = p + q, or p - q when `negate`. The same formula with Z2 = 1, and
+// -(x, y) = (-x, y) swaps y+x with y-x and flips the sign of 2dxy.
+void AddNiels(Point &r, Point const &p, Niels const &q, bool negate) {
+  Fe a, b, c, d, e, f, g, h;
+  FeSub(a, p.Y, p.X);
+  FeMul(a, a, negate ? q.yPlusX : q.yMinusX);
+  FeAdd(b, p.Y, p.X);
+  FeMul(b, b, negate ? q.yMinusX : q.yPlusX);
+  FeMul(c, p.T, q.xy2d);
+  FeAdd(d, p.Z, p.Z);
+
+  FeSub(e, b, a);
+  FeAdd(h, b, a);
+  if (negate) {
+    FeAdd(f, d, c);
+    FeSub(g, d, c);
+  } else {
+    FeSub(f, d, c);
+    FeAdd(g, d, c);
+  }
+  FeMul(r.X, e, f);
+  FeMul(r.Y, g, h);
+  FeMul(r.T, e, h);
+  FeMul(r.Z, f, g);
+}
+
+Niels ToNiels(Point const &p) {
+  Fe zInverse, x, y;
+  inv_EltFp25519_1w_x64(zInverse, Mutable(p.Z));
+  FeMul(x, p.X, zInverse);
+  FeMul(y, p.Y, zInverse);
+
+  Niels n;
+  FeAdd(n.yPlusX, y, x);
+  FeSub(n.yMinusX, y, x);
+  FeMul(n.xy2d, x, y);
+  FeMul(n.xy2d, n.xy2d, D2);
+  return n;
+}
+
+// Maps zeroed memory for the table: explicit huge pages first, then an aligned
+// region with transparent huge pages advised, then plain pages.
+void *MapTable(std::size_t size, std::size_t &mappedSize, char const *&backing) {
+  mappedSize = RoundUp(size, HugePageSize);
+
+  void *memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (memory != MAP_FAILED) {
+    backing = "hugetlb";
+    return memory;
+  }
+
+  // THP only kicks in for whole aligned 2 MB, so over-map and trim.
+  std::size_t const overSize = mappedSize + HugePageSize;
+  memory = mmap(nullptr, overSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  auto const address = reinterpret_cast<std::uintptr_t>(memory);
+  auto const aligned = RoundUp(address, HugePageSize);
+  if (aligned > address) {
+    munmap(memory, aligned - address);
+  }
+  if (aligned + mappedSize < address + overSize) {
+    munmap(reinterpret_cast<void *>(aligned + mappedSize), address + overSize - aligned - mappedSize);
+  }
+  memory = reinterpret_cast<void *>(aligned);
+
+  backing = madvise(memory, mappedSize, MADV_HUGEPAGE) == 0 ? "thp" : "4k";
+  return memory;
+}
+
+// Digit `i` of the w-bit windows of the little-endian 256-bit `k`.
+int Window(std::uint64_t const *k, unsigned i, unsigned windowBits) {
+  unsigned const bit   = i * windowBits;
+  unsigned const limb  = bit / 64;
+  unsigned const shift = bit % 64;
+  if (limb >= 4) {
+    return 0;
+  }
+  std::uint64_t bits = k[limb] >> shift;
+  if (shift + windowBits > 64 && limb + 1 < 4) {
+    bits |= k[limb + 1] << (64 - shift);
+  }
+  return static_cast<int>(bits & ((std::uint64_t{1} << windowBits) - 1));
+}
+
+}  // namespace
+
+unsigned const DefaultWindowBits = 6;
+
+namespace {
+
+unsigned sharedWindowBits = DefaultWindowBits;
+
+}  // namespace
+
+FixedBaseTable::FixedBaseTable(unsigned windowBits)
+    : windowBits_(windowBits),
+      // Windows over 256 bits rather than 255: the top one then holds less
+      // than 2^(w-1) and still fits the table with the carry added.
+      nDigits_((256 + windowBits - 1) / windowBits),
+      nMultiples_(1u << (windowBits - 1)),
+      size_(std::size_t{nDigits_} * nMultiples_ * sizeof(Niels)) {
+  Expects(windowBits >= MinWindowBits && windowBits <= MaxWindowBits);
+
+  entries_ = MapTable(size_, mappedSize_, backing_);
+  auto *entries = static_cast<Niels *>(entries_);
+
+  Point base{};
+  std::memcpy(base.X, BaseX, sizeof(Fe));
+  std::memcpy(base.Y, BaseY, sizeof(Fe));
+  base.Z[0] = 1;
+  FeMul(base.T, BaseX, BaseY);
+
+  for (unsigned i = 0; i < nDigits_; ++i) {
+    Point multiple = base;
+    for (unsigned j = 0; j < nMultiples_; ++j) {
+      entries[i * nMultiples_ + j] = ToNiels(multiple);
+      Add(multiple, multiple, base);
+    }
+
+    // base *= 2^w
+    for (unsigned doubling = 0; doubling < windowBits_; ++doubling) {
+      Add(base, base, base);
+    }
+  }
+}
+
+FixedBaseTable::~FixedBaseTable() {
+  munmap(entries_, mappedSize_);
+}
+
+void FixedBaseTable::generate(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) const {
+  auto const *entries = static_cast<Niels const *>(entries_);
+  int const   half    = 1 << (windowBits_ - 1);
+
+  // u = (1 + y) / (1 - y) = (Z + Y) / (Z - Y) wants an inversion per key,
+  // which Montgomery's trick turns into one per batch plus 3 multiplications
+  // per key. A clamped scalar is never a multiple of the group order, so no
+  // Z - Y is ever zero and poisons the batch.
+  Fe numerators[MaxBatch], denominators[MaxBatch], products[MaxBatch];
+
+  for (std::size_t first = 0; first < n; first += MaxBatch) {
+    std::size_t const batch = std::min(n - first, MaxBatch);
+
+    for (std::size_t key = 0; key < batch; ++key) {
+      // Clamp a copy the way X25519 does: a multiple of the cofactor, bit 254 set.
+      std::uint64_t k[4];
+      std::memcpy(k, secretKeys[first + key].data(), sizeof k);
+      k[0] &= ~std::uint64_t{7};
+      k[3] &= ~(std::uint64_t{1} << 63);
+      k[3] |= std::uint64_t{1} << 62;
+
+      // Digits in [0, 2^w) carried over into [-2^(w-1), 2^(w-1)) on the fly,
+      // but for the top one which just takes the carry (see the constructor).
+      // Here is where the time goes: skip what is zero, branch on the sign.
+      Point r = Identity();
+      int carry = 0;
+      for (unsigned i = 0; i < nDigits_; ++i) {
+        int digit = Window(k, i, windowBits_) + carry;
+        if (i + 1 < nDigits_) {
+          carry = (digit + half) >> windowBits_;
+          digit -= carry << windowBits_;
+        }
+        if (digit != 0) {
+          AddNiels(r, r, entries[i * nMultiples_ + std::abs(digit) - 1], digit < 0);
+        }
+      }
+
+      FeAdd(numerators[key], r.Z, r.Y);
+      FeSub(denominators[key], r.Z, r.Y);
+      if (key == 0) {
+        std::memcpy(products[0], denominators[0], sizeof(Fe));
+      } else {
+        FeMul(products[key], products[key - 1], denominators[key]);
+      }
+    }
+
+    // inverse = 1 / (denominators[0] * ... * denominators[key]), walking down.
+    Fe inverse, u;
+    inv_var_EltFp25519_1w_x64(inverse, products[batch - 1]);
+    for (std::size_t key = batch; key-- > 0; ) {
+      if (key == 0) {
+        FeMul(u, numerators[0], inverse);
+      } else {
+        FeMul(u, products[key - 1], inverse);
+        FeMul(u, numerators[key], u);
+        FeMul(inverse, inverse, denominators[key]);
+      }
+      fred_EltFp25519_1w_x64(u);
+
+      // Limbs are little-endian and so is x86.
+      std::memcpy(publicKeys[first + key].data(), u, sizeof u);
+    }
+  }
+}
+
+void SetFixedBaseWindowBits(unsigned windowBits) {
+  sharedWindowBits = windowBits;
+}
+
+FixedBaseTable const &SharedFixedBaseTable() {
+  static FixedBaseTable const table(sharedWindowBits);
+  return table;
+}
+
+void X25519KeyGenVartime(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) {
+  SharedFixedBaseTable().generate(publicKeys, secretKeys, n);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+
+#include "main.hxx"
+
+// Variable-time fixed-base X25519 keygen for the search.
+//
+// The rfc7748 keygen is constant-time: it walks the whole ladder and swaps on
+// every bit, which is what a secret deserves. Candidate keys of the search are
+// throwaway guesses though, so here the (clamped) scalar is recoded into
+// signed radix-2^w digits and [k]B is summed up on the birationally equivalent
+// Edwards curve from a precomputed table of [j * 2^(w*i)]B, skipping the zero
+// digits. The u-coordinate is then (Z + Y) / (Z - Y), the very same one the
+// constant-time path produces. Batches of keys share the inversion, a
+// variable-time safegcd one at that.
+//
+// A wider window means fewer additions per key and a bigger table:
+//
+//    w   additions   table
+//    2     128        24 KB
+//    4      64        48 KB
+//    6      43       129 KB
+//    8      32       384 KB
+//
+// so the sweet spot depends on the cache sizes of the host (see `--bench`).
+// The default of 6 stays well inside a 256 KB L2 next to everything else.
+class FixedBaseTable {
+public:
+  static constexpr unsigned MinWindowBits = 2;
+  static constexpr unsigned MaxWindowBits = 8;
+
+  // Keys of a batch share one field inversion, up to this many of them.
+  static constexpr std::size_t MaxBatch = 64;
+
+  // Computes the table in memory backed by huge pages when the system lets us.
+  explicit FixedBaseTable(unsigned windowBits);
+  ~FixedBaseTable();
+
+  FixedBaseTable(FixedBaseTable const &) = delete;
+  FixedBaseTable &operator=(FixedBaseTable const &) = delete;
+
+  void generate(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) const;
+
+  unsigned    windowBits() const { return windowBits_; }
+  std::size_t size() const { return size_; }
+  // "hugetlb", "thp" or "4k", whatever the mapping ended up with.
+  char const *backing() const { return backing_; }
+
+private:
+  unsigned    windowBits_;
+  unsigned    nDigits_;
+  unsigned    nMultiples_;
+  std::size_t size_;
+  std::size_t mappedSize_;
+  char const *backing_;
+  void       *entries_;  // [nDigits_][nMultiples_] precomputed points
+};
+
+// The window of the table `X25519KeyGenVartime()` uses; `--table-bits` sets it
+// before the first key is generated.
+extern unsigned const DefaultWindowBits;
+void SetFixedBaseWindowBits(unsigned windowBits);
+FixedBaseTable const &SharedFixedBaseTable();
+
+// Generates with the shared table, built on the first call.
+void X25519KeyGenVartime(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n);
@@ -0,0 +1,63 @@
+#include "keygen.hxx"
+
+#include "fixedbase.hxx"
+
+#include <rfc7748_precompted.h>
+#if defined(WITH_CURVE25519_MEHDI)
+# include <curve25519_dh.h>
+#endif
+
+namespace {
+
+// Both libraries clamp the secret key in place (rfc7748 restores it, mehdi
+// doesn't), so they get a copy. The rfc7748 ladder is called directly rather
+// than through its exported X25519_KeyGen_x64 pointer, so that `make lto`
+// can inline it.
+
+void Rfc7748KeyGen(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    alignas(32) SecretKey secretKey = secretKeys[i];
+    x25519_keygen_precmp_x64(publicKeys[i].data(), secretKey.data());
+  }
+}
+
+#if defined(WITH_CURVE25519_MEHDI)
+void MehdiKeyGen(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    SecretKey secretKey = secretKeys[i];
+    curve25519_dh_CalculatePublicKey_fast(publicKeys[i].data(), secretKey.data());
+  }
+}
+#endif
+
+}  // namespace
+
+char const DefaultKeyGenBackend[] = "vartime";
+
+KeyGenBackend const KeyGenBackends[] = {
+  {"rfc7748", "Montgomery ladder over the 8 KB Table_Ladder_8k (armfazh/rfc7748_precomputed)",
+   Rfc7748KeyGen, true},
+  {"vartime", "variable-time signed radix-2^w Edwards comb over a --table-bits table, search only",
+   X25519KeyGenVartime, false},
+#if defined(WITH_CURVE25519_MEHDI)
+  {"mehdi", "Edwards base point folding with base_folding8.h and asm64 field code (mehdi/curve25519)",
+   MehdiKeyGen, true},
+#endif
+};
+std::size_t const nKeyGenBackends = sizeof KeyGenBackends / sizeof KeyGenBackends[0];
+
+KeyGenBackend const *FindKeyGenBackend(std::string const &name) {
+  if (name.empty()) {
+    return FindKeyGenBackend(DefaultKeyGenBackend);
+  }
+  for (std::size_t i = 0; i < nKeyGenBackends; ++i) {
+    if (name == KeyGenBackends[i].name) {
+      return &KeyGenBackends[i];
+    }
+  }
+  return nullptr;
+}
+
+KeyGenBackend const &ConstantTimeKeyGen() {
+  return KeyGenBackends[0];
+}
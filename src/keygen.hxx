@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "main.hxx"
+
+// X25519 fixed-base key generation, i.e. the public key of a secret key.
+//
+// Different backends win on different microarchitectures, so the engine goes
+// through this table and `--curve-backend` picks the entry. Backends take
+// batches so that batched ones can amortize over them; a backend never
+// modifies the secret keys.
+//
+// Variable-time backends leak the scalar through timing and caches. That is
+// fine for the throwaway guesses of the search, but a key that is going to be
+// printed as a hit is derived once more with `ConstantTimeKeyGen()`.
+struct KeyGenBackend {
+  char const *name;
+  char const *description;
+  void (*generate)(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n);
+  bool        constantTime;
+};
+
+extern KeyGenBackend const KeyGenBackends[];
+extern std::size_t const   nKeyGenBackends;
+
+// Returns nullptr for an unknown name, the default backend for an empty one.
+KeyGenBackend const *FindKeyGenBackend(std::string const &name);
+
+// What `--curve-backend` defaults to.
+extern char const DefaultKeyGenBackend[];
+
+// The backend for anything that ends up being shown as a real secret.
+KeyGenBackend const &ConstantTimeKeyGen();
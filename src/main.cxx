@@ -1,183 +1,300 @@
 #include <algorithm>
-#include <atomic>
-#include <chrono>
-#include <forward_list>
-#include <functional>
+#include <cstdlib>
 #include <iostream>
-#include <mutex>
-#include <random>
-#include <thread>
 
+#include "bench.hxx"
+#include "campaign.hxx"
+#include "engine.hxx"
+#include "fixedbase.hxx"
+#include "keygen.hxx"
 #include "main.hxx"
-#include "utils.hxx"
+#include "options.hxx"
+#include "selftest.hxx"
+#include "sha256x8.hxx"
+#include "stats.hxx"
+#include "verify.hxx"
 
 #include <gsl/gsl>
-#include <picosha2.h>
-#include <pthread.h>
-#include <rfc7748_precompted.h>
 
-struct Hashing {
-  struct Stats {
-    std::size_t tries{0};
-    std::chrono::duration<double> elapsedTime{0};
-  };
-
-  Hashing(unsigned nWords)
-      : nWords_(nWords)
-  {}
-  Hashing(Hashing const &other) = delete;
-  Hashing(Hashing&& other)
-      : nWords_(other.nWords_), stats_(other.stats_)
-  {}
-
-  void operator () (std::mutex &printingMutex, std::atomic_bool &isDone) {
-    PROFILE(
-        std::chrono::duration<double> shaTime{0};
-        std::chrono::duration<double> curveTime{0};
-    )
-
-    std::random_device              rd;
-    std::default_random_engine      gen(rd());
-    std::uniform_int_distribution<> dis(0, DictSize - 1);
-
-    bool hit = false;
-    int  wordIndices[nWords_];
-    std::array<unsigned char, 32> secretKey;
-    std::array<unsigned char, 32> publicKey;
-    auto const &publicKeyReference = PublicKeys[nWords_ - 1];
-
-    auto const startedAt = std::chrono::steady_clock::now();
-    for (; !isDone.load(std::memory_order_relaxed); ) {
-      // OPTIMIZATION:
-      // Assuming checking the atomic bool costs a few iterations,
-      // let do them all first and then check the bool once.
-      // The value 128 here is just a guess.
-      //
-      for (unsigned hadmadeLoop__ = 0; hadmadeLoop__ < 128; ++hadmadeLoop__) {
-        // Obtain the SHA256 hash of a random passphrase.
-        PROFILE(auto const shaAt = std::chrono::steady_clock::now());
-        picosha2::hash256_one_by_one hasher;
-        // To avoid building a phrase by joining strings with a whitespace character
-        // and to prevent unnecessary memory allocations we run the first separately
-        // and run the loop for the rest:
-        //  * feed the hasher with the first random word...
-        for (unsigned i = 0; i < 1; ++i) {
-          auto const wordIndex = dis(gen);
-          decltype(auto) word = Words[wordIndex];
-          wordIndices[i] = wordIndex;
-
-          hasher.process(word.cbegin(), word.cend());
-        }
-        //  * feed with the rest random words with the leading whitespace character.
-        for (unsigned i = 1; i < nWords_; ++i) {
-          auto const wordIndex = dis(gen);
-          decltype(auto) word = Words[wordIndex];
-          wordIndices[i] = wordIndex;
-
-          hasher.process(Whitespace.cbegin(), Whitespace.cend());
-          hasher.process(word.cbegin(), word.cend());
-        }
-        hasher.finish();
-        hasher.get_hash_bytes(secretKey.begin(), secretKey.end());
-        PROFILE(shaTime += std::chrono::steady_clock::now() - shaAt);
-
-        // We've got the key in `secretKey`, which is used in X25519 hashing algorithm
-        // as the private key.
-        // The next we do is obtaining the public key.
-
-        PROFILE(auto const curveAt = std::chrono::steady_clock::now());
-        X25519_KeyGen_x64(publicKey.data(), secretKey.data());
-        PROFILE(curveTime += std::chrono::steady_clock::now() - curveAt);
+int main(int argc, char *argv[]) {
+  Options options;
+  if (argc < 2 || !ParseOptions(argc, argv, options)) {
+    Usage(argv[0]);
+    return 1;
+  }
 
-        // Let's call it a nice try.
-        ++stats_.tries;
+  if (!FindKeyGenBackend(options.curveBackend)) {
+    std::cout << "Unknown curve backend: " << options.curveBackend << '\n';
+    Usage(argv[0]);
+    return 1;
+  }
+  if (!FindHashKernel(options.hashKernel)) {
+    std::cout << "Unknown hash kernel: " << options.hashKernel << '\n';
+    Usage(argv[0]);
+    return 1;
+  }
+  if (options.batch > MaxKeyBatch) {
+    std::cout << "Batch out of range: " << options.batch << " (1.." << MaxKeyBatch << ")\n";
+    Usage(argv[0]);
+    return 1;
+  }
+  if (options.tableBits != 0) {
+    if (options.tableBits < FixedBaseTable::MinWindowBits || options.tableBits > FixedBaseTable::MaxWindowBits) {
+      std::cout << "Table bits out of range: " << options.tableBits << '\n';
+      Usage(argv[0]);
+      return 1;
+    }
+    SetFixedBaseWindowBits(options.tableBits);
+  }
 
-        // As promised, `publicKey` contains the public key now, and
-        // it is time to check if we have found the collision!
-        // If so, mark our mission done and run away from the loops.
-        if (publicKey == publicKeyReference) {
-          hit = true;
-          break;
-        }
-      }
+  if (options.enumerate && options.nWords > MaxEnumerateWords) {
+    std::cout << "Can't enumerate more than " << MaxEnumerateWords << " words\n";
+    Usage(argv[0]);
+    return 1;
+  }
+  if (options.shardIndex >= options.shardCount) {
+    std::cout << "No shard " << options.shardIndex << " of " << options.shardCount << '\n';
+    Usage(argv[0]);
+    return 1;
+  }
+  if (!options.enumerate && options.campaign.empty() && (options.shardCount > 1 || !options.checkpointPath.empty())) {
+    std::cout << "Shards and checkpoints are of --enumerate and --permute\n";
+    Usage(argv[0]);
+    return 1;
+  }
+  if (options.smtSplit && !options.checkpointPath.empty()) {
+    std::cout << "Can't checkpoint --smt-split\n";
+    Usage(argv[0]);
+    return 1;
+  }
 
-      if (hit) {
-        isDone.store(true, std::memory_order_relaxed);
-        break;
+  if (!options.statsDump.empty()) {
+    return DumpStats(options.statsDump, std::cout) ? 0 : 1;
+  }
+  if (!options.campaign.empty()) {
+    auto const policies = CampaignPolicies + nCampaignPolicies;
+    if (!options.policy.empty() && std::find(CampaignPolicies, policies, options.policy) == policies) {
+      std::cout << "Unknown campaign policy: " << options.policy << '\n';
+      Usage(argv[0]);
+      return 1;
+    }
+    for (auto const nWords : options.campaign) {
+      if (nWords < 1 || nWords > nWallets
+          || std::count(options.campaign.cbegin(), options.campaign.cend(), nWords) > 1) {
+        std::cout << "Bad campaign word count: " << nWords << '\n';
+        Usage(argv[0]);
+        return 1;
       }
     }
-
-    {
-      stats_.elapsedTime = std::chrono::steady_clock::now() - startedAt;
-
-      auto const speed = static_cast<double>(stats_.tries) / stats_.elapsedTime.count();
-      std::vector<std::string> passphraseWords;
-      std::transform(&wordIndices[0], &wordIndices[0] + nWords_,
-                     std::back_inserter(passphraseWords),
-                     [](auto i) -> std::string {
-                       return gsl::to_string(Words[i]);
-                     });
-      std::string const passphrase = join(passphraseWords, ' ');
-
-      // Lock the mutex to prevent threads from messing stdout.
-      std::lock_guard<std::mutex> printingLock(printingMutex);
-      std::cout << (hit ? (SMILE SMILE SMILE SMILE SMILE SMILE SMILE SMILE SMILE SMILE)
-                        : (SMITE SMITE SMITE SMITE SMITE SMITE SMITE SMITE SMITE SMITE)) << '\n'
-                << "took " << stats_.elapsedTime.count() << " s"
-                PROFILE(<< "\tsha256-ing  "     << shaTime.count() << " s")
-                PROFILE(<< "\tcurve25519-ing  " << curveTime.count() << " s") << '\n'
-                << "speed: " << speed << " tries/s per thread\n"
-                << "tries: " << stats_.tries << '\n'
-                << "passphrase: " << passphrase << '\n'
-                << "secret key (sha256):  " << to_hexstring(secretKey) << '\n'
-                << "public key:           " << to_hexstring(publicKey) << '\n'
-                << "reference public key: " << to_hexstring(publicKeyReference) << '\n';
+    if (!options.threadsFile.empty() || !options.tracePath.empty()) {
+      std::cout << "A campaign sizes its runs itself and traces none of them\n";
+      Usage(argv[0]);
+      return 1;
     }
+    return Campaign(options);
   }
-
- private:
-  unsigned nWords_;
-  Stats    stats_;
-};
-
-int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    Usage(argv[0]);
-    return 1;
+  if (options.bench) {
+    return Bench(options);
+  }
+  if (options.selfTest) {
+    return SelfTest(options);
+  }
+  if (options.verify) {
+    return Verify(options);
   }
 
-  int const numOfWords = std::atoi(argv[1]);
-  if (numOfWords < 1 || static_cast<unsigned>(numOfWords) > nWallets) {
+  if (options.nWords < 1 || options.nWords > nWallets) {
     Usage(argv[0]);
     return 2;
   }
 
-  unsigned const nThreads = std::max(1u, std::thread::hardware_concurrency());
-  std::cout << "Starting on " << Wallets[numOfWords - 1] << '\n'
-            << "Dict size: " << DictSize << "; " << numOfWords << "-word passphrase\n"
-            << "Concurrency: " << std::thread::hardware_concurrency() << " vCPUs; "
-            << "running " << nThreads << " threads\n";
+  std::cout << "Starting on " << Wallets[options.nWords - 1] << '\n'
+            << "Dict size: " << DictSize << "; " << options.nWords << "-word passphrase\n";
 
-  std::mutex       printingMutex;
-  std::atomic_bool isDone{false};
+  Target const target{options.nWords, PublicKeys[options.nWords - 1]};
+  return Run(options, target).failed ? 1 : 0;
+}
 
-  std::forward_list<std::thread> threads;
-  for (unsigned i = 0; i < nThreads; ++i) {
-    threads.emplace_front(Hashing(numOfWords), std::ref(printingMutex), std::ref(isDone));
-  }
+bool ParseOptions(int argc, char *argv[], Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    gsl::cstring_span<> const arg = gsl::ensure_z(argv[i]);
 
-  for (auto &thread : threads) {
-    thread.join();
+    if (arg == "--perf-counters") {
+      options.perfCounters = true;
+    } else if (arg == "--smt-split") {
+      options.smtSplit = true;
+    } else if (arg == "--enumerate") {
+      options.enumerate = true;
+    } else if (arg == "--permute") {
+      options.enumerate = true;
+      options.permute   = true;
+    } else if (arg == "--permutation-key" && i + 1 < argc) {
+      options.permutationKey = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--checkpoint" && i + 1 < argc) {
+      options.checkpointPath = argv[++i];
+    } else if (arg == "--shard" && i + 1 < argc) {
+      char *slash = nullptr;
+      options.shardIndex = static_cast<unsigned>(std::strtoul(argv[++i], &slash, 10));
+      if (*slash != '/') {
+        return false;
+      }
+      options.shardCount = static_cast<unsigned>(std::strtoul(slash + 1, nullptr, 10));
+    } else if (arg == "--selftest") {
+      options.selfTest = true;
+    } else if (arg == "--verify") {
+      options.verify = true;
+    } else if (arg == "--bench") {
+      options.bench = true;
+    } else if (arg == "--campaign" && i + 1 < argc) {
+      // A comma-separated list of word counts.
+      for (char *list = argv[++i]; *list; ) {
+        options.campaign.push_back(static_cast<unsigned>(std::strtoul(list, &list, 10)));
+        if (*list == ',') {
+          ++list;
+        } else if (*list) {
+          return false;
+        }
+      }
+    } else if (arg == "--policy" && i + 1 < argc) {
+      options.policy = argv[++i];
+    } else if (arg == "--stats-dump" && i + 1 < argc) {
+      options.statsDump = argv[++i];
+    } else if (arg == "--bench-time" && i + 1 < argc) {
+      options.benchTime = std::atof(argv[++i]);
+    } else if (arg == "--bench-trials" && i + 1 < argc) {
+      options.benchTrials = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--bench-baseline" && i + 1 < argc) {
+      options.benchBaseline = argv[++i];
+    } else if (arg == "--bench-save" && i + 1 < argc) {
+      options.benchSave = argv[++i];
+    } else if (arg == "--curve-backend" && i + 1 < argc) {
+      options.curveBackend = argv[++i];
+    } else if (arg == "--hash-kernel" && i + 1 < argc) {
+      options.hashKernel = argv[++i];
+    } else if (arg == "--table-bits" && i + 1 < argc) {
+      options.tableBits = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--batch" && i + 1 < argc) {
+      // 0 is what leaves the default in place, so it can't be asked for.
+      options.batch = std::strtoull(argv[++i], nullptr, 10);
+      if (options.batch == 0) {
+        std::cout << "Batch out of range: " << argv[i] << " (1.." << MaxKeyBatch << ")\n";
+        return false;
+      }
+    } else if (arg == "--stop-latency-ms" && i + 1 < argc) {
+      options.stopLatency = std::max(0.0, std::atof(argv[++i])) / 1e3;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      options.threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+    } else if (arg == "--trace" && i + 1 < argc) {
+      options.tracePath = argv[++i];
+    } else if (arg == "--stats" && i + 1 < argc) {
+      options.statsName = argv[++i];
+    } else if (arg == "--threads-file" && i + 1 < argc) {
+      options.threadsFile = argv[++i];
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      options.iterations = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      options.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--report" && i + 1 < argc) {
+      options.reportInterval = std::atof(argv[++i]);
+    } else if (arg.size() > 0 && arg[0] == '-') {
+      return false;
+    } else if (options.nWords == 0) {
+      options.nWords = static_cast<unsigned>(std::max(0, std::atoi(argv[i])));
+    } else {
+      return false;
+    }
   }
 
-  return 0;
+  return true;
 }
 
 void Usage(char const *progname) {
-  std::cout << "Usage: " << progname << " <1..12>\n"
+  std::cout << "Usage: " << progname << " [options] <1..12>\n"
+            << "       " << progname << " --enumerate|--permute [options] <1..5>\n"
+            << "       " << progname << " --selftest [<1..12>]\n"
+            << "       " << progname << " --verify [--iterations <n>] [--seed <n>]\n"
+            << "       " << progname << " --bench [--bench-time <sec>] [--bench-trials <n>]\n"
+            << "               [--bench-save <json>] [--bench-baseline <json>] [<1..12>]\n"
+            << "       " << progname << " --campaign <n>,<n>,... [--policy <name>] [options]\n"
+            << "       " << progname << " --stats-dump <name>\n"
+            << '\n'
+            << "Modes:\n"
+            << "  --selftest       plant known passphrases of up to <n> (1 by default) words\n"
+            << "                   and make sure the engine finds them with every curve backend\n"
+            << "                   and hash kernel, at random, enumerated and permuted\n"
+            << "  --verify         check every SHA-256 and X25519 kernel against the reference\n"
+            << "                   implementations on <n> (1000000) random and all edge-case inputs\n"
+            << "  --bench          time passphrase hashing, every curve backend and the whole\n"
+            << "                   engine with each, <sec> (1) seconds apiece, for <n> (3) words;\n"
+            << "                   the median of <n> (10) trials with its 95% confidence interval\n"
+            << "                   (and ops per joule, if RAPL is readable),\n"
+            << "                   and against a --bench-save of before, a faster/slower/no change\n"
+            << "                   verdict per stage (exit code 5 when any got slower)\n"
+            << "  --campaign       attack the built-in targets of those word counts at once on one\n"
+            << "                   pool of threads; up to " << MaxEnumerateWords << " words they are enumerated\n"
+            << "                   (--permute applies), and each gets a <path>.<n> --checkpoint\n"
+            << "  --stats-dump     print the stats segment <name> of a run in the Prometheus\n"
+            << "                   text format, e.g. for the node exporter textfile collector\n"
+            << '\n'
+            << "Options:\n"
+            << "  --enumerate      try every passphrase once, in order, instead of at random;\n"
+            << "                   threads steal ranges from each other, so none idles at the end\n"
+            << "  --permute        try every passphrase once, in a random-looking order that a\n"
+            << "                   keyed Feistel permutation of the keyspace fixes\n"
+            << "  --permutation-key <n>\n"
+            << "                   the key of that order (0); runs that are to share shards or\n"
+            << "                   checkpoints must agree on it\n"
+            << "  --shard <k>/<n>  enumerate only the k-th of n equal parts (0-based) of the\n"
+            << "                   keyspace, in the walk order, for n machines to split it\n"
+            << "  --checkpoint <path>\n"
+            << "                   resume the enumeration from <path> if it is there, and save\n"
+            << "                   what is left to it every 10 seconds and at the end\n"
+            << "  --perf-counters  report IPC and cache/branch misses per candidate\n"
+            << "                   (per-thread perf_event_open counters)\n"
+            << "  --report <sec>   print the rate (and RAPL power, if readable) every <sec> seconds\n"
+            << "  --stats <name>   publish live counters in /dev/shm/<name> (see --stats-dump)\n"
+            << "  --trace <path>   write a timeline of every worker's batches, stages, chunks,\n"
+            << "                   steals and migrations as Chrome trace JSON for Perfetto\n"
+            << "  --curve-backend <name>\n"
+            << "                   X25519 keygen backend to search with:\n";
+  for (std::size_t i = 0; i < nKeyGenBackends; ++i) {
+    std::cout << "                   * " << KeyGenBackends[i].name
+              << (KeyGenBackends[i].name == std::string(DefaultKeyGenBackend) ? " (default)" : "")
+              << ": " << KeyGenBackends[i].description << '\n';
+  }
+  std::cout << "  --hash-kernel <name>\n"
+            << "                   SHA-256 kernel to hash the passphrases with:\n";
+  for (std::size_t i = 0; i < nHashKernels; ++i) {
+    std::cout << "                   * " << HashKernels[i].name << (i == 0 ? " (default)" : "")
+              << ": " << HashKernels[i].description << '\n';
+  }
+  std::cout << "  --table-bits <w>  window of the vartime backend, "
+            << FixedBaseTable::MinWindowBits << ".." << FixedBaseTable::MaxWindowBits << " (" << DefaultWindowBits
+            << "); the table takes 96 * 2^(w-1) * ceil(256/w) bytes\n"
+            << "  --batch <n>      keys per keygen call, 1.." << MaxKeyBatch << " (8); the vartime backend shares one\n"
+            << "                   field inversion among them\n"
+            << "  --stop-latency-ms <ms>\n"
+            << "                   how long a worker may take to notice a hit or a stop: the\n"
+            << "                   keygen of a batch is cut to fit\n"
+            << "                   (no bound by default; the stop is looked at between stages)\n"
+            << "  --threads <n>    workers to run; by default as many as the cgroup CPU quota\n"
+            << "                   (cpu.max) and the affinity mask (cpuset) allow\n"
+            << "  --smt-split      experimental: instead of doing every stage on each thread,\n"
+            << "                   pair a hashing thread with a keygen thread on the two\n"
+            << "                   hyperthreads of a core; the thread counts become pairs\n"
+            << "  --threads-file <path>\n"
+            << "                   switch to the worker count written in <path> whenever it\n"
+            << "                   changes (or on SIGUSR2); idle workers park, keeping up to\n"
+            << "                   the affinity count ready to grow back into\n"
+            << "  --policy <name>  how a campaign shares its threads out:\n"
+            << "                   * exhaust-first (default): all to the enumeration closest\n"
+            << "                     to done at its live rate, then on to the next\n"
+            << "                   * proportional: to each target by its chance of a hit per\n"
+            << "                     second, taking turns where that is less than a thread\n"
             << '\n'
             << "Acknowledges:\n"
             << " * SHA256:         https://github.com/okdshin/PicoSHA2\n"
             << " * curve25519:     https://github.com/armfazh/rfc7748_precomputed\n"
+            << " * curve25519:     https://github.com/msotoodeh/curve25519\n"
             << " * GSL:            https://github.com/Microsoft/GSL\n";
 }
@@ -287,8 +287,9 @@ static gsl::cstring_span<> const Words[] = {
 };
 static unsigned const DictSize = sizeof Words / sizeof Words[0];
 
+using SecretKey = std::array<unsigned char, 32>;
 using PublicKey = std::array<unsigned char, 32>;
-static PublicKey PublicKeys[] = {
+static PublicKey const PublicKeys[] = {
   {{0x59, 0xdd, 0x8b, 0x04, 0x72, 0xc2, 0xf6, 0x34, 0xf7, 0xbf, 0xbf, 0x60, 0x82, 0xe8, 0x2a, 0x0a, 0xad, 0x59, 0x84, 0x03, 0x40, 0xbe, 0xea, 0x37, 0xa0, 0xd4, 0x0a, 0x00, 0xa3, 0x50, 0x22, 0x41}},
   {{0x87, 0x3b, 0x1b, 0x26, 0x6e, 0xd4, 0xbb, 0x08, 0xf3, 0x7d, 0xc2, 0x74, 0x1e, 0xd4, 0xa8, 0xc0, 0x21, 0xf4, 0x5d, 0xe1, 0xbd, 0xe5, 0x73, 0x97, 0xdc, 0xc3, 0xf9, 0x17, 0x1c, 0xb6, 0x8f, 0x69}},
   {{0x1c, 0xdf, 0xe1, 0xe4, 0x4b, 0xaf, 0xfc, 0x84, 0x16, 0xdc, 0x88, 0xff, 0x9e, 0x18, 0x2b, 0xe5, 0x31, 0x6a, 0xef, 0x49, 0xb0, 0xd8, 0x88, 0xf0, 0x30, 0x59, 0xd4, 0x15, 0x21, 0xc1, 0xdd, 0x68}},
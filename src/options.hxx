@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What the command line asked for. See `Usage()` for the meaning of each.
+struct Options {
+  unsigned      nWords{0};
+  bool          perfCounters{false};
+  bool          enumerate{false};   // walk the keyspace in order, not at random
+  bool          permute{false};     // ...in the order of a keyed permutation
+  std::uint64_t permutationKey{0};
+  unsigned      shardIndex{0};      // of the keyspace split into `shardCount` parts
+  unsigned      shardCount{1};
+  std::string   checkpointPath;     // of the enumeration to resume and save, empty is none
+  double        reportInterval{0};  // seconds, 0 is never
+  std::string   curveBackend;       // empty is the default one
+  std::string   hashKernel;         // empty is the default one
+  unsigned      tableBits{0};       // window of the vartime backend, 0 is the default
+  std::size_t   batch{0};           // keys per keygen call, 0 is the default
+  double        stopLatency{0};     // seconds a worker may take to notice a stop, 0 is no bound
+  bool          smtSplit{false};    // hashing and keygen on sibling hyperthreads
+  unsigned      threads{0};         // workers to run, 0 is what the cgroup allows
+  std::string   threadsFile;        // of the worker count to switch to at runtime
+  std::string   statsName;          // of the /dev/shm stats segment, empty is none
+  std::string   tracePath;          // of the Chrome trace to write, empty is none
+
+  std::vector<unsigned> campaign;   // word counts of the targets to run at once
+  std::string   policy;             // of the campaign's thread sharing, empty is the default
+
+  bool          selfTest{false};
+  bool          verify{false};
+  bool          bench{false};
+  std::string   statsDump;          // segment to print in Prometheus format
+
+  std::size_t   iterations{0};      // of --verify, 0 is the default
+  std::uint64_t seed{0};            // of --verify, 0 is a random one
+  double        benchTime{1};       // seconds per --bench stage
+  unsigned      benchTrials{0};     // of every --bench stage, 0 is the default
+  std::string   benchBaseline;      // JSON of an earlier --bench to compare with
+  std::string   benchSave;          // where to write the JSON of this one
+
+  // Not command line options: modes that run the engine many times (the
+  // self-test, the benchmark) turn the per-thread and summary printing off,
+  // and the benchmark pins each worker to a CPU of its own.
+  bool          verbose{true};
+  bool          pinThreads{false};
+};
+
+// Returns false on a malformed command line.
+bool ParseOptions(int argc, char *argv[], Options &options);
@@ -0,0 +1,167 @@
+#include "perf.hxx"
+
+#include <cstring>
+#include <iomanip>
+#include <ostream>
+
+#include <cpuid.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// There is no generic FP/SIMD event, so pick the vendor's raw one:
+//  * Intel FP_ARITH_INST_RETIRED (0xc7), all umasks (scalar and packed of every width);
+//  * AMD FpRetSseAvxOps (0x03), all umasks.
+// Returns 0 when we don't know what to ask for.
+std::uint64_t RawFpEventConfig() {
+  unsigned eax, ebx, ecx, edx;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+
+  char vendor[13] = {};
+  std::memcpy(vendor + 0, &ebx, 4);
+  std::memcpy(vendor + 4, &edx, 4);
+  std::memcpy(vendor + 8, &ecx, 4);
+  if (std::strcmp(vendor, "GenuineIntel") == 0) {
+    return 0xffc7;
+  }
+  if (std::strcmp(vendor, "AuthenticAMD") == 0) {
+    return 0xff03;
+  }
+  return 0;
+}
+
+int OpenEvent(std::uint32_t type, std::uint64_t config) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof attr);
+  attr.size           = sizeof attr;
+  attr.type           = type;
+  attr.config         = config;
+  attr.disabled       = 1;
+  attr.exclude_kernel = 1;  // perf_event_paranoid=2 is the usual default.
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1, -1, 0));
+}
+
+constexpr std::uint64_t CacheMissConfig(std::uint64_t cache) {
+  return cache
+      | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+}  // namespace
+
+PerfCounters::Sample &PerfCounters::Sample::operator += (Sample const &other) {
+  for (unsigned i = 0; i < nEvents; ++i) {
+    values[i] += other.values[i];
+    valid[i]   = valid[i] || other.valid[i];
+  }
+  return *this;
+}
+
+PerfCounters::PerfCounters() {
+  fds_[Cycles]       = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  fds_[Instructions] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  fds_[BranchMisses] = OpenEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  fds_[L1dMisses]    = OpenEvent(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_L1D));
+  fds_[LlcMisses]    = OpenEvent(PERF_TYPE_HW_CACHE, CacheMissConfig(PERF_COUNT_HW_CACHE_LL));
+
+  auto const fpConfig = RawFpEventConfig();
+  fds_[FpOps] = fpConfig ? OpenEvent(PERF_TYPE_RAW, fpConfig) : -1;
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto const fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+bool PerfCounters::available() const {
+  for (auto const fd : fds_) {
+    if (fd >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+  for (auto const fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+void PerfCounters::stop() {
+  for (auto const fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+}
+
+PerfCounters::Sample PerfCounters::read() const {
+  Sample sample;
+  for (unsigned i = 0; i < nEvents; ++i) {
+    // { value, time_enabled, time_running }
+    std::uint64_t data[3];
+    if (fds_[i] < 0 || ::read(fds_[i], data, sizeof data) != sizeof data || data[2] == 0) {
+      continue;
+    }
+
+    // The kernel multiplexes when there are more events than PMU slots,
+    // so scale the value up to the whole enabled time.
+    sample.values[i] = data[2] < data[1]
+        ? static_cast<std::uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+        : data[0];
+    sample.valid[i] = true;
+  }
+  return sample;
+}
+
+char const *PerfCounters::name(Event event) {
+  switch (event) {
+    case Cycles:       return "cycles";
+    case Instructions: return "instructions";
+    case BranchMisses: return "branch misses";
+    case L1dMisses:    return "L1D misses";
+    case LlcMisses:    return "LLC misses";
+    case FpOps:        return "FP/SIMD ops";
+    case nEvents:      break;
+  }
+  return "?";
+}
+
+void PrintPerfSample(std::ostream &os, PerfCounters::Sample const &sample, std::size_t tries) {
+  using Event = PerfCounters::Event;
+
+  if (sample.valid[Event::Cycles] && sample.valid[Event::Instructions] && sample.values[Event::Cycles]) {
+    os << "IPC " << std::setprecision(3)
+       << static_cast<double>(sample.values[Event::Instructions]) / sample.values[Event::Cycles]
+       << std::setprecision(6) << "; ";
+  }
+
+  os << "per candidate:";
+  bool any = false;
+  for (unsigned i = 0; i < Event::nEvents; ++i) {
+    if (!sample.valid[i]) {
+      continue;
+    }
+    os << (any ? ", " : " ") << PerfCounters::name(static_cast<Event>(i)) << ' '
+       << (tries ? static_cast<double>(sample.values[i]) / tries : 0.0);
+    any = true;
+  }
+  if (!any) {
+    os << " n/a (perf_event_open failed; check perf_event_paranoid or the PMU)";
+  }
+}
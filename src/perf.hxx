@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+// Hardware performance counters of the calling thread, read through
+// perf_event_open(2). Throughput alone doesn't tell why a box is slow, IPC
+// and misses per candidate do.
+//
+// Every event is opened on its own (not as a group), so a host that lacks,
+// say, the LLC event or runs under a hypervisor without a virtual PMU still
+// reports whatever is there.
+class PerfCounters {
+ public:
+  enum Event : unsigned {
+    Cycles,
+    Instructions,
+    BranchMisses,
+    L1dMisses,
+    LlcMisses,
+    FpOps,
+    nEvents
+  };
+
+  struct Sample {
+    std::array<std::uint64_t, nEvents> values{};
+    std::array<bool, nEvents>          valid{};
+
+    Sample &operator += (Sample const &other);
+  };
+
+  // Opens the counters for the calling thread, so construct it on the
+  // thread to be measured. Counters start disabled.
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(PerfCounters const &) = delete;
+  PerfCounters &operator = (PerfCounters const &) = delete;
+
+  bool   available() const;
+  void   start();
+  void   stop();
+  Sample read() const;
+
+  static char const *name(Event event);
+
+ private:
+  std::array<int, nEvents> fds_;
+};
+
+// Prints IPC and per-candidate event counts, one line, no trailing newline.
+void PrintPerfSample(std::ostream &os, PerfCounters::Sample const &sample, std::size_t tries);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+// A keyed bijection of [0, size) onto itself, for walking the keyspace in an
+// order that looks random but never repeats: a balanced Feistel network over
+// the smallest even number of bits that holds `size`, cycle-walked (applied
+// again while the result falls outside) back into range. The domain is less
+// than 4x the range, so that takes under 4 rounds of the network on average,
+// a few dozen multiplications per candidate against the ~10^4 cycles of the
+// keygen.
+//
+// It is not meant to be hard to invert, only to scatter: the same key gives
+// the same order, which is what lets checkpoints and shards agree.
+class KeyspacePermutation {
+public:
+  static unsigned const Rounds = 4;
+
+  KeyspacePermutation(std::uint64_t size, std::uint64_t key) : size_(size) {
+    unsigned bits = 2;
+    while (bits < 64 && (std::uint64_t{1} << bits) < size) {
+      bits += 2;
+    }
+    halfBits_ = bits / 2;
+    halfMask_ = (std::uint64_t{1} << halfBits_) - 1;
+    for (auto &roundKey : roundKeys_) {
+      roundKey = SplitMix(key);
+    }
+  }
+
+  std::uint64_t size() const { return size_; }
+
+  std::uint64_t operator()(std::uint64_t index) const {
+    do {
+      index = encrypt(index);
+    } while (index >= size_);
+    return index;
+  }
+
+private:
+  static std::uint64_t SplitMix(std::uint64_t &state) {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  std::uint64_t encrypt(std::uint64_t block) const {
+    std::uint64_t left  = block >> halfBits_;
+    std::uint64_t right = block & halfMask_;
+    for (auto const roundKey : roundKeys_) {
+      std::uint64_t f = (right ^ roundKey) * 0xbf58476d1ce4e5b9;
+      f ^= f >> 31;
+      f *= 0x94d049bb133111eb;
+      f ^= f >> 29;
+      std::uint64_t const next = left ^ (f & halfMask_);
+      left  = right;
+      right = next;
+    }
+    return (left << halfBits_) | right;
+  }
+
+  std::uint64_t size_;
+  unsigned      halfBits_;
+  std::uint64_t halfMask_;
+  std::uint64_t roundKeys_[Rounds];
+};
@@ -0,0 +1,69 @@
+#include "rapl.hxx"
+
+#include <fstream>
+
+#include <dirent.h>
+
+namespace {
+
+char const PowercapDir[] = "/sys/class/powercap";
+
+bool ReadCounter(std::string const &path, std::uint64_t &value) {
+  std::ifstream in(path);
+  return static_cast<bool>(in >> value);
+}
+
+}  // namespace
+
+Rapl::Rapl() {
+  DIR *dir = opendir(PowercapDir);
+  if (!dir) {
+    return;
+  }
+
+  while (dirent const *entry = readdir(dir)) {
+    std::string const name = entry->d_name;
+
+    // Only the top level package zones, "intel-rapl:0", "intel-rapl:1", ...
+    // The "intel-rapl:0:0"-like subzones (core, uncore, dram) are either
+    // included into the package already or not what we pay for.
+    std::string const prefix = "intel-rapl:";
+    if (name.compare(0, prefix.size(), prefix) != 0
+        || name.find(':', prefix.size()) != std::string::npos) {
+      continue;
+    }
+
+    std::string const zone = std::string(PowercapDir) + '/' + name + '/';
+    Domain domain;
+    domain.energyPath = zone + "energy_uj";
+    if (!ReadCounter(zone + "max_energy_range_uj", domain.maxRange)
+        || !ReadCounter(domain.energyPath, domain.last)) {
+      continue;
+    }
+    domains_.push_back(domain);
+  }
+
+  closedir(dir);
+}
+
+void Rapl::sample() {
+  for (auto &domain : domains_) {
+    std::uint64_t now;
+    if (!ReadCounter(domain.energyPath, now)) {
+      continue;
+    }
+
+    domain.accumulated += now >= domain.last
+        ? now - domain.last
+        : domain.maxRange - domain.last + now;
+    domain.last = now;
+  }
+}
+
+double Rapl::joules() const {
+  std::uint64_t microjoules = 0;
+  for (auto const &domain : domains_) {
+    microjoules += domain.accumulated;
+  }
+  return static_cast<double>(microjoules) * 1e-6;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Package energy counters of RAPL as exposed by the powercap driver under
+// /sys/class/powercap/intel-rapl:N (AMD Zen shows up there as well).
+//
+// The counters are free running and wrap at `max_energy_range_uj`, which takes
+// a few minutes at full load, so `sample()` should be called periodically and
+// not just at the start and the end of a run. On hosts without the interface,
+// or where `energy_uj` is readable by root only, `available()` is false and
+// everything reads zero.
+class Rapl {
+ public:
+  Rapl();
+
+  bool available() const { return !domains_.empty(); }
+
+  // Folds the current counter values into the running totals.
+  void sample();
+
+  // Energy of all the packages since construction, in joules.
+  double joules() const;
+
+ private:
+  struct Domain {
+    std::string   energyPath;
+    std::uint64_t maxRange{0};
+    std::uint64_t last{0};
+    std::uint64_t accumulated{0};
+  };
+
+  std::vector<Domain> domains_;
+};
@@ -0,0 +1,166 @@
+#include "scheduler.hxx"
+
+#include <algorithm>
+
+#include <gsl/gsl>
+
+namespace {
+
+std::uint64_t Pack(std::uint64_t begin, std::uint64_t end) {
+  return (end << 32) | begin;
+}
+
+std::uint64_t Begin(std::uint64_t bounds) { return bounds & 0xffffffff; }
+std::uint64_t End(std::uint64_t bounds)   { return bounds >> 32; }
+
+}  // namespace
+
+RangeScheduler::RangeScheduler(std::uint64_t size, unsigned nWorkers)
+    : size_(size),
+      unit_(size / 0xffffffff + 1),
+      nWorkers_(nWorkers),
+      shares_(new Share[nWorkers]) {
+  Expects(nWorkers > 0);
+
+  std::uint64_t const units = (size + unit_ - 1) / unit_;
+  for (unsigned i = 0; i < nWorkers; ++i) {
+    shares_[i].bounds.store(Pack(units * i / nWorkers, units * (i + 1) / nWorkers),
+                            std::memory_order_relaxed);
+  }
+}
+
+bool RangeScheduler::take(unsigned worker, std::uint64_t want, Range &range) {
+  std::uint64_t const wantUnits = std::max<std::uint64_t>(1, want / unit_);
+  auto &own = shares_[worker].bounds;
+
+  range.stolenFrom = NotStolen;
+  for (;;) {
+    auto bounds = own.load(std::memory_order_acquire);
+    while (Begin(bounds) < End(bounds)) {
+      auto const begin = Begin(bounds);
+      auto const end   = std::min(End(bounds), begin + wantUnits);
+      claim(worker, begin * unit_, std::min(end * unit_, size_));
+      if (own.compare_exchange_weak(bounds, Pack(end, End(bounds)))) {
+        range.begin = begin * unit_;
+        range.end   = std::min(end * unit_, size_);
+        return true;
+      }
+    }
+    if (!steal(worker, range.stolenFrom)) {
+      claim(worker, 0, 0);
+      return false;
+    }
+  }
+}
+
+bool RangeScheduler::steal(unsigned worker, unsigned &victim) {
+  for (;;) {
+    // The biggest share is the one most likely to hold the tail up.
+    std::uint64_t biggest = 0;
+    victim = nWorkers_;
+    for (unsigned i = 0; i < nWorkers_; ++i) {
+      auto const bounds = shares_[i].bounds.load(std::memory_order_relaxed);
+      if (i != worker && End(bounds) - Begin(bounds) > biggest) {
+        biggest = End(bounds) - Begin(bounds);
+        victim  = i;
+      }
+    }
+    if (victim == nWorkers_) {
+      victim = NotStolen;
+      return false;
+    }
+
+    // The back half, or the last unit. Our own share is empty, so nobody
+    // else touches it until it is filled again.
+    auto &theirs = shares_[victim].bounds;
+    auto  bounds = theirs.load(std::memory_order_acquire);
+    auto const begin = Begin(bounds), end = End(bounds);
+    if (begin >= end) {
+      continue;
+    }
+    auto const middle = begin + (end - begin) / 2;
+    claim(worker, middle * unit_, std::min(end * unit_, size_));
+    if (theirs.compare_exchange_strong(bounds, Pack(begin, middle))) {
+      shares_[worker].bounds.store(Pack(middle, end), std::memory_order_release);
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+}
+
+std::uint64_t RangeScheduler::remaining() const {
+  std::uint64_t units = 0;
+  for (unsigned i = 0; i < nWorkers_; ++i) {
+    auto const bounds = shares_[i].bounds.load(std::memory_order_relaxed);
+    units += End(bounds) - Begin(bounds);
+  }
+  return std::min(units * unit_, size_);
+}
+
+void RangeScheduler::done(unsigned worker, std::uint64_t upTo) {
+  auto const &share = shares_[worker];
+  claim(worker, std::max(upTo, share.claimBegin.load(std::memory_order_relaxed)),
+        share.claimEnd.load(std::memory_order_relaxed));
+}
+
+void RangeScheduler::giveBack(unsigned worker, std::uint64_t upTo, std::uint64_t end) {
+  // Nobody else moves the front of a share, so ours still starts where the
+  // chunk ended; steals only take from the back.
+  auto &own = shares_[worker].bounds;
+  auto  bounds = own.load(std::memory_order_acquire);
+  Expects(Begin(bounds) == (end + unit_ - 1) / unit_);
+  while (!own.compare_exchange_weak(bounds, Pack(upTo / unit_, End(bounds)))) {
+  }
+  // Back in the share before it leaves the claim.
+  done(worker, end);
+}
+
+void RangeScheduler::claim(unsigned worker, std::uint64_t begin, std::uint64_t end) {
+  auto &share = shares_[worker];
+  auto const sequence = share.claimSequence.load(std::memory_order_relaxed);
+  share.claimSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  share.claimBegin.store(begin, std::memory_order_relaxed);
+  share.claimEnd.store(end, std::memory_order_relaxed);
+  // Sequentially consistent, like the CAS that may follow: whoever sees the
+  // range gone from a share sees it claimed.
+  share.claimSequence.store(sequence + 2);
+}
+
+std::vector<RangeScheduler::Range> RangeScheduler::pending() const {
+  // A steal moves a range between two shares and a claim, so one pass could
+  // see it in none of them. Read until two passes agree; the workers change
+  // these only once per chunk, so that is rarely more than two.
+  std::vector<std::uint64_t> before(2 * nWorkers_), after(2 * nWorkers_);
+  auto const readState = [this](std::vector<std::uint64_t> &state) {
+    for (unsigned i = 0; i < nWorkers_; ++i) {
+      state[2 * i]     = shares_[i].bounds.load();
+      state[2 * i + 1] = shares_[i].claimSequence.load();
+    }
+  };
+
+  std::vector<Range> ranges;
+  for (;;) {
+    readState(before);
+    ranges.clear();
+    for (unsigned i = 0; i < nWorkers_; ++i) {
+      auto const bounds = before[2 * i];
+      if (Begin(bounds) < End(bounds)) {
+        ranges.push_back({Begin(bounds) * unit_, std::min(End(bounds) * unit_, size_)});
+      }
+      auto const begin = shares_[i].claimBegin.load();
+      auto const end   = shares_[i].claimEnd.load();
+      if (begin < end) {
+        ranges.push_back({begin, end});
+      }
+    }
+    readState(after);
+    bool stable = before == after;
+    for (unsigned i = 0; stable && i < nWorkers_; ++i) {
+      stable = before[2 * i + 1] % 2 == 0;
+    }
+    if (stable) {
+      return ranges;
+    }
+  }
+}
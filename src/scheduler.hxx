@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Hands out [0, size) in chunks to `nWorkers` workers, for the exhaustive
+// walk of the keyspace.
+//
+// Each worker starts off with an equal share. It takes chunks off the front
+// of its own share, and when that runs dry it steals the back half of the
+// biggest share left. A share is a [begin, end) pair packed into one 64-bit
+// atomic word, so taking and stealing are single CASes; no locks. Ranges
+// only ever shrink or get handed over whole, so the pairs can't come back
+// (no ABA).
+//
+// To fit two bounds in 64 bits they count in units of `unit()` candidates,
+// which is 1 unless the keyspace exceeds 2^32.
+//
+// For checkpoints, each worker also has a claim: the part of its last chunk
+// it has not reported `done()` yet. The claim is set before a chunk leaves
+// a share (and before a steal takes a range), so `pending()` never misses a
+// candidate that is in flight. It may repeat a few that are done, though,
+// which only costs their retry on resume. That holds as long as a worker
+// takes its next chunk only after it has checked the whole of the last one,
+// or given the rest of it back.
+class RangeScheduler {
+public:
+  static unsigned const NotStolen = ~0u;
+
+  struct Range {
+    std::uint64_t begin{0};
+    std::uint64_t end{0};
+    // The worker whose share it came out of, when it took a steal.
+    unsigned      stolenFrom{NotStolen};
+  };
+
+  RangeScheduler(std::uint64_t size, unsigned nWorkers);
+
+  // Takes about `want` candidates for `worker`, stealing when its own share
+  // is gone. Returns false once there is nothing left anywhere.
+  bool take(unsigned worker, std::uint64_t want, Range &range);
+
+  // Candidates not handed out yet, roughly.
+  std::uint64_t remaining() const;
+
+  // `worker` has checked every candidate of its chunk below `upTo`.
+  void done(unsigned worker, std::uint64_t upTo);
+
+  // `worker` stops short of the end of its chunk at `upTo` (to park, say) and
+  // puts the rest back in front of its share, where others steal it from.
+  // The share counts in units, so the candidates of the unit `upTo` is in
+  // come back from its start and get tried again.
+  void giveBack(unsigned worker, std::uint64_t upTo, std::uint64_t end);
+
+  // What is not known to be done: the shares and the claims, as they are
+  // right now, unsorted and possibly overlapping.
+  std::vector<Range> pending() const;
+
+  std::uint64_t size() const { return size_; }
+  std::uint64_t unit() const { return unit_; }
+  // How many times a worker found its share empty and got one from another.
+  std::uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+  // Own cache lines, or the CASes of neighbours would fight over them. The
+  // claim is written by the owner only, under a seqlock.
+  struct alignas(64) Share {
+    std::atomic<std::uint64_t> bounds{0};
+    std::atomic<std::uint32_t> claimSequence{0};
+    std::atomic<std::uint64_t> claimBegin{0};
+    std::atomic<std::uint64_t> claimEnd{0};
+  };
+
+  bool steal(unsigned worker, unsigned &victim);
+  void claim(unsigned worker, std::uint64_t begin, std::uint64_t end);
+
+  std::uint64_t              size_;
+  std::uint64_t              unit_;
+  unsigned                   nWorkers_;
+  std::unique_ptr<Share[]>   shares_;
+  std::atomic<std::uint64_t> steals_{0};
+};
@@ -0,0 +1,119 @@
+#include "selftest.hxx"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "engine.hxx"
+#include "keygen.hxx"
+#include "main.hxx"
+#include "sha256x8.hxx"
+
+#include <picosha2.h>
+#include <rfc7748_precompted.h>
+
+namespace {
+
+// Where in the keyspace we plant the passphrase, as a fraction of its size.
+// Far enough from the start that an ordered walk has to get somewhere, and
+// irrational enough that none of the words comes out as the first or the last.
+double const PlantedOffset = 0.6180339887;
+
+// How many times the expected number of tries we wait for a random hit.
+// The chance to miss a present key in 20x the keyspace is e^-20.
+double const TimeoutFactor = 20;
+
+std::chrono::duration<double> const MinTimeout{30};
+
+// Every combination gets walked in each of these orders.
+enum class Order { Random, Enumerate, Permute };
+
+Order const Orders[]     = {Order::Random, Order::Enumerate, Order::Permute};
+char const *OrderNames[] = {"random", "enumerate", "permute"};
+
+// Word indices of the passphrase at `offset` of the keyspace, the first word
+// being the least significant digit.
+std::vector<unsigned> PassphraseAt(double offset, unsigned nWords) {
+  std::vector<unsigned> wordIndices(nWords);
+  for (unsigned i = 0; i < nWords; ++i) {
+    offset *= DictSize;
+    wordIndices[nWords - 1 - i] = std::min(DictSize - 1, static_cast<unsigned>(offset));
+    offset -= std::floor(offset);
+  }
+  return wordIndices;
+}
+
+// The slow and obviously correct way from a passphrase to its public key.
+PublicKey ReferencePublicKey(std::string const &passphrase) {
+  std::array<unsigned char, 32> secretKey;
+  picosha2::hash256(passphrase.cbegin(), passphrase.cend(), secretKey.begin(), secretKey.end());
+
+  PublicKey publicKey;
+  X25519_KeyGen_x64(publicKey.data(), secretKey.data());
+  return publicKey;
+}
+
+}  // namespace
+
+int SelfTest(Options const &options) {
+  Options quiet = options;
+  quiet.verbose = false;
+  quiet.checkpointPath.clear();
+  quiet.shardIndex = 0;
+  quiet.shardCount = 1;
+
+  unsigned const maxWords = std::max(1u, options.nWords);
+  bool           passed   = true;
+
+  for (std::size_t backend = 0; backend < nKeyGenBackends; ++backend) {
+    for (std::size_t kernel = 0; kernel < nHashKernels; ++kernel) {
+      for (auto const order : Orders) {
+        quiet.curveBackend = KeyGenBackends[backend].name;
+        quiet.hashKernel   = HashKernels[kernel].name;
+        quiet.enumerate    = order != Order::Random;
+        quiet.permute      = order == Order::Permute;
+
+        double rate = 0;  // tries/s measured by the previous case
+        for (unsigned nWords = 1; nWords <= maxWords; ++nWords) {
+          if (quiet.enumerate && nWords > MaxEnumerateWords) {
+            break;
+          }
+
+          auto const planted    = PassphraseAt(PlantedOffset, nWords);
+          auto const passphrase = PassphraseString(planted);
+          double const keyspace = std::pow(static_cast<double>(DictSize), nWords);
+
+          auto const timeout = rate > 0
+              ? std::max(MinTimeout, std::chrono::duration<double>(TimeoutFactor * keyspace / rate))
+              : MinTimeout;
+
+          std::cout << "selftest: " << nWords << "-word " << quiet.curveBackend << ' ' << quiet.hashKernel << ' '
+                    << OrderNames[static_cast<unsigned>(order)] << ": \"" << passphrase << "\" ... " << std::flush;
+
+          Target const target{nWords, ReferencePublicKey(passphrase)};
+          auto const result = Run(quiet, target, timeout);
+          rate = static_cast<double>(result.tries) / result.elapsedTime.count();
+
+          if (!result.hit) {
+            std::cout << "FAILED: not found after " << result.tries << " tries in "
+                      << result.elapsedTime.count() << " s\n";
+            passed = false;
+          } else if (result.passphrase != planted) {
+            std::cout << "FAILED: hit on \"" << PassphraseString(result.passphrase) << "\"\n";
+            passed = false;
+          } else {
+            std::cout << "found after " << result.tries << " tries in " << result.elapsedTime.count()
+                      << " s; stopped in " << result.stopLatency.count() * 1e3 << " ms\n";
+          }
+        }
+      }
+    }
+  }
+
+  std::cout << "selftest: " << (passed ? "passed" : "FAILED") << '\n';
+  return passed ? 0 : 3;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "options.hxx"
+
+// Plants known passphrases of 1..`options.nWords` words (1 if not given),
+// derives their public keys through the plain picosha2 + X25519 path and
+// makes sure the engine finds every one of them in time: with every curve
+// backend and hash kernel, at random, enumerated and permuted (up to
+// `MaxEnumerateWords` words for the last two).
+//
+// Returns the process exit code: 0 when all passed.
+int SelfTest(Options const &options);
@@ -0,0 +1,126 @@
+#include "sha256.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+std::uint32_t const InitialState[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+std::uint32_t const RoundConstants[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline std::uint32_t Rotr(std::uint32_t x, unsigned n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+inline std::uint32_t LoadBigEndian(unsigned char const *p) {
+  std::uint32_t x;
+  std::memcpy(&x, p, sizeof x);
+  return __builtin_bswap32(x);
+}
+
+inline void StoreBigEndian(unsigned char *p, std::uint32_t x) {
+  x = __builtin_bswap32(x);
+  std::memcpy(p, &x, sizeof x);
+}
+
+void Compress(std::uint32_t state[8], unsigned char const *block) {
+  std::uint32_t w[64];
+  for (unsigned i = 0; i < 16; ++i) {
+    w[i] = LoadBigEndian(block + 4 * i);
+  }
+  for (unsigned i = 16; i < 64; ++i) {
+    auto const s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    auto const s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+
+  auto a = state[0], b = state[1], c = state[2], d = state[3];
+  auto e = state[4], f = state[5], g = state[6], h = state[7];
+  for (unsigned i = 0; i < 64; ++i) {
+    auto const t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g))
+                    + RoundConstants[i] + w[i];
+    auto const t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+}  // namespace
+
+void Sha256::reset() {
+  std::memcpy(state_, InitialState, sizeof state_);
+  length_   = 0;
+  buffered_ = 0;
+}
+
+void Sha256::update(gsl::span<unsigned char const> data) {
+  auto const *p    = data.data();
+  std::size_t size = static_cast<std::size_t>(data.size());
+  length_ += size;
+
+  // Top up a partial block first, then whole blocks straight from the input.
+  if (buffered_ > 0) {
+    auto const n = std::min(size, sizeof buffer_ - buffered_);
+    std::memcpy(buffer_ + buffered_, p, n);
+    buffered_ += n;
+    p         += n;
+    size      -= n;
+    if (buffered_ < sizeof buffer_) {
+      return;
+    }
+    Compress(state_, buffer_);
+    buffered_ = 0;
+  }
+  for (; size >= sizeof buffer_; p += sizeof buffer_, size -= sizeof buffer_) {
+    Compress(state_, p);
+  }
+  std::memcpy(buffer_, p, size);
+  buffered_ = size;
+}
+
+void Sha256::final(Digest &digest) {
+  // 0x80, zeros up to 56 mod 64, then the length in bits, big-endian.
+  std::uint64_t const bits = length_ * 8;
+
+  buffer_[buffered_++] = 0x80;
+  if (buffered_ > 56) {
+    std::memset(buffer_ + buffered_, 0, sizeof buffer_ - buffered_);
+    Compress(state_, buffer_);
+    buffered_ = 0;
+  }
+  std::memset(buffer_ + buffered_, 0, 56 - buffered_);
+  StoreBigEndian(buffer_ + 56, static_cast<std::uint32_t>(bits >> 32));
+  StoreBigEndian(buffer_ + 60, static_cast<std::uint32_t>(bits));
+  Compress(state_, buffer_);
+
+  for (unsigned i = 0; i < 8; ++i) {
+    StoreBigEndian(digest.data() + 4 * i, state_[i]);
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <gsl/gsl>
+
+// Streaming SHA-256 that never allocates: the partial block lives in a fixed
+// 64-byte buffer inside the object, so one hasher can be `reset()` and reused
+// for any number of messages of any length.
+class Sha256 {
+public:
+  using Digest = std::array<unsigned char, 32>;
+
+  Sha256() { reset(); }
+
+  void reset();
+
+  void update(gsl::span<unsigned char const> data);
+  void update(gsl::cstring_span<> text) {
+    update({reinterpret_cast<unsigned char const *>(text.data()), text.size()});
+  }
+
+  // Pads, writes the digest out and leaves the hasher to be `reset()`.
+  void final(Digest &digest);
+
+private:
+  std::uint32_t state_[8];
+  std::uint64_t length_;    // bytes so far
+  unsigned char buffer_[64];
+  std::size_t   buffered_;
+};
@@ -0,0 +1,332 @@
+#include "sha256x8.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "engine.hxx"
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+
+namespace {
+
+unsigned const    nLanes    = 8;
+std::size_t const SlotSize  = 16;
+// 12 words of up to 12 letters and 11 whitespaces, plus the padding.
+unsigned const    MaxWords  = 12;
+unsigned const    MaxBlocks = 3;
+
+// The dictionary, one word and its trailing whitespace per zero-padded slot,
+// and a slot of zeros past the last one.
+struct PackedDictionary {
+  PackedDictionary() {
+    std::size_t longest = 0;
+    for (unsigned i = 0; i < DictSize; ++i) {
+      auto const &word = Words[i];
+      auto const  size = static_cast<std::size_t>(word.size()) + 1;
+      // The gathers take four bytes from at most two words.
+      Expects(size >= 4 && size <= SlotSize);
+      std::memcpy(slots[i], word.data(), word.size());
+      slots[i][word.size()] = static_cast<unsigned char>(Whitespace[0]);
+      lengths[i] = static_cast<std::int32_t>(size);
+      longest    = std::max(longest, size);
+    }
+    // The longest passphrase, its 0x80 and its length still fit.
+    Expects(MaxWords * longest - 1 + 9 <= MaxBlocks * 64);
+  }
+
+  alignas(SlotSize) unsigned char slots[DictSize + 1][SlotSize] = {};
+  std::int32_t                    lengths[DictSize];
+};
+
+PackedDictionary const &Dictionary() {
+  static PackedDictionary const dictionary;
+  return dictionary;
+}
+
+std::uint32_t const InitialState[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+std::uint32_t const RoundConstants[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+template <int N>
+inline __m256i Rotr(__m256i x) {
+  return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+inline __m256i Add(__m256i a, __m256i b) { return _mm256_add_epi32(a, b); }
+inline __m256i Xor(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+
+// Big-endian words out of little-endian loads and back.
+inline __m256i ByteSwap(__m256i x) {
+  __m256i const mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  return _mm256_shuffle_epi8(x, mask);
+}
+
+// Rows of eight 32-bit words become columns, for the states on the way out.
+void Transpose(__m256i r[8]) {
+  __m256i const t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+  __m256i const t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+  __m256i const t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+  __m256i const t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+  __m256i const t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+  __m256i const t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+  __m256i const t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+  __m256i const t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+  __m256i const u0 = _mm256_unpacklo_epi64(t0, t2);
+  __m256i const u1 = _mm256_unpackhi_epi64(t0, t2);
+  __m256i const u2 = _mm256_unpacklo_epi64(t1, t3);
+  __m256i const u3 = _mm256_unpackhi_epi64(t1, t3);
+  __m256i const u4 = _mm256_unpacklo_epi64(t4, t6);
+  __m256i const u5 = _mm256_unpackhi_epi64(t4, t6);
+  __m256i const u6 = _mm256_unpacklo_epi64(t5, t7);
+  __m256i const u7 = _mm256_unpackhi_epi64(t5, t7);
+
+  r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+// One block for each of the eight lanes; w[i] holds message word i of all of them.
+void Compress(__m256i state[8], __m256i w[16]) {
+  __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+  __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (unsigned i = 0; i < 64; ++i) {
+    if (i >= 16) {
+      __m256i const w15 = w[(i - 15) & 15];
+      __m256i const w2  = w[(i - 2) & 15];
+      __m256i const s0  = Xor(Xor(Rotr<7>(w15), Rotr<18>(w15)), _mm256_srli_epi32(w15, 3));
+      __m256i const s1  = Xor(Xor(Rotr<17>(w2), Rotr<19>(w2)), _mm256_srli_epi32(w2, 10));
+      w[i & 15] = Add(Add(w[i & 15], s0), Add(w[(i - 7) & 15], s1));
+    }
+
+    __m256i const sigma1 = Xor(Xor(Rotr<6>(e), Rotr<11>(e)), Rotr<25>(e));
+    __m256i const choose = Xor(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+    __m256i const t1     = Add(Add(Add(h, sigma1), Add(choose, _mm256_set1_epi32(static_cast<int>(RoundConstants[i])))),
+                               w[i & 15]);
+    __m256i const sigma0 = Xor(Xor(Rotr<2>(a), Rotr<13>(a)), Rotr<22>(a));
+    __m256i const major  = Xor(Xor(_mm256_and_si256(a, b), _mm256_and_si256(a, c)), _mm256_and_si256(b, c));
+    __m256i const t2     = Add(sigma0, major);
+    h = g;
+    g = f;
+    f = e;
+    e = Add(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = Add(t1, t2);
+  }
+
+  state[0] = Add(state[0], a);
+  state[1] = Add(state[1], b);
+  state[2] = Add(state[2], c);
+  state[3] = Add(state[3], d);
+  state[4] = Add(state[4], e);
+  state[5] = Add(state[5], f);
+  state[6] = Add(state[6], g);
+  state[7] = Add(state[7], h);
+}
+
+// Eight passphrases; the lanes past `n` repeat the last one.
+void Hash8(SecretKey *secretKeys, unsigned const *wordIndices, unsigned nWords, std::size_t n) {
+  auto const &dictionary = Dictionary();
+  auto const *slots      = reinterpret_cast<int const *>(dictionary.slots);
+  __m256i const lanes    = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256i const sources  = _mm256_mullo_epi32(_mm256_min_epi32(lanes, _mm256_set1_epi32(static_cast<int>(n - 1))),
+                                              _mm256_set1_epi32(static_cast<int>(nWords)));
+
+  // Slot offset and length of word j of every lane, row `nWords` being the
+  // zero slot past the end of the dictionary.
+  alignas(32) std::int32_t wordSlots[MaxWords + 1][nLanes];
+  alignas(32) std::int32_t wordLengths[MaxWords + 1][nLanes];
+  __m256i length = _mm256_set1_epi32(-1);
+  for (unsigned j = 0; j < nWords; ++j) {
+    __m256i const index = _mm256_i32gather_epi32(reinterpret_cast<int const *>(wordIndices),
+                                                 Add(sources, _mm256_set1_epi32(static_cast<int>(j))), 4);
+    __m256i const wordLength = _mm256_i32gather_epi32(dictionary.lengths, index, 4);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(wordSlots[j]), _mm256_slli_epi32(index, 4));
+    _mm256_store_si256(reinterpret_cast<__m256i *>(wordLengths[j]), wordLength);
+    length = Add(length, wordLength);
+  }
+  _mm256_store_si256(reinterpret_cast<__m256i *>(wordSlots[nWords]), _mm256_set1_epi32(DictSize * SlotSize));
+  _mm256_store_si256(reinterpret_cast<__m256i *>(wordLengths[nWords]), _mm256_setzero_si256());
+
+  // The message ends where the whitespace of the last word is; that byte is
+  // the 0x80 and the length in bits goes at the end of the last block.
+  __m256i const nBlocks = _mm256_srli_epi32(Add(length, _mm256_set1_epi32(9 + 63)), 6);
+  __m256i const bits    = _mm256_slli_epi32(length, 3);
+  __m256i const marker  = _mm256_set1_epi32(static_cast<unsigned char>(Whitespace[0]) ^ 0x80);
+  alignas(32) std::int32_t laneBlocks[nLanes];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(laneBlocks), nBlocks);
+  auto const minBlocks = *std::min_element(laneBlocks, laneBlocks + nLanes);
+  auto const maxBlocks = *std::max_element(laneBlocks, laneBlocks + nLanes);
+
+  // Where every lane is: word j, at byte `start` of the message.
+  __m256i const lastWord  = _mm256_set1_epi32(static_cast<int>(nWords - 1));
+  __m256i const ones      = _mm256_set1_epi32(-1);
+  __m256i const thirtyTwo = _mm256_set1_epi32(32);
+  __m256i word       = _mm256_setzero_si256();
+  __m256i start      = _mm256_setzero_si256();
+  __m256i slot       = _mm256_load_si256(reinterpret_cast<__m256i const *>(wordSlots[0]));
+  __m256i wordLength = _mm256_load_si256(reinterpret_cast<__m256i const *>(wordLengths[0]));
+  __m256i nextSlot   = _mm256_load_si256(reinterpret_cast<__m256i const *>(wordSlots[std::min(1u, nWords)]));
+  __m256i nextHead   = _mm256_i32gather_epi32(slots, nextSlot, 1);
+
+  __m256i state[8];
+  for (unsigned i = 0; i < 8; ++i) {
+    state[i] = _mm256_set1_epi32(static_cast<int>(InitialState[i]));
+  }
+
+  for (std::int32_t block = 0; block < maxBlocks; ++block) {
+    __m256i w[16];
+    for (unsigned i = 0; i < 16; ++i) {
+      __m256i const position = _mm256_set1_epi32(block * 64 + static_cast<std::int32_t>(i) * 4);
+
+      // The rest of the current word, then the head of the next one. Words
+      // are at least four bytes long with their whitespace, so the four
+      // bytes never reach a third word, and the shifts by 32 or more that
+      // come out of the clamps are zeros.
+      __m256i const remaining = _mm256_sub_epi32(Add(start, wordLength), position);
+      __m256i const kept      = _mm256_min_epi32(_mm256_max_epi32(remaining, _mm256_setzero_si256()),
+                                                 _mm256_set1_epi32(4));
+      __m256i const head      = _mm256_mask_i32gather_epi32(
+          _mm256_setzero_si256(), slots, Add(slot, _mm256_sub_epi32(position, start)),
+          _mm256_cmpgt_epi32(remaining, _mm256_setzero_si256()), 1);
+      __m256i bytes = _mm256_or_si256(
+          _mm256_and_si256(head, _mm256_srlv_epi32(ones, _mm256_sub_epi32(thirtyTwo, _mm256_slli_epi32(kept, 3)))),
+          _mm256_sllv_epi32(nextHead, _mm256_slli_epi32(remaining, 3)));
+      bytes = Xor(bytes, _mm256_sllv_epi32(marker, _mm256_slli_epi32(_mm256_sub_epi32(length, position), 3)));
+
+      w[i] = ByteSwap(bytes);
+      if (i == 15) {
+        w[i] = _mm256_or_si256(
+            w[i], _mm256_and_si256(bits, _mm256_cmpeq_epi32(nBlocks, _mm256_set1_epi32(block + 1))));
+      }
+
+      // On to the next word in the lanes that are done with this one.
+      __m256i const advance = _mm256_andnot_si256(
+          _mm256_cmpeq_epi32(word, lastWord),
+          _mm256_cmpgt_epi32(_mm256_set1_epi32(block * 64 + static_cast<std::int32_t>(i) * 4 + 4),
+                             _mm256_sub_epi32(Add(start, wordLength), _mm256_set1_epi32(1))));
+      if (_mm256_testz_si256(advance, advance)) {
+        continue;
+      }
+      word  = _mm256_sub_epi32(word, advance);
+      start = _mm256_blendv_epi8(start, Add(start, wordLength), advance);
+      slot  = _mm256_blendv_epi8(slot, nextSlot, advance);
+      __m256i const row  = Add(_mm256_slli_epi32(word, 3), lanes);
+      wordLength         = _mm256_blendv_epi8(wordLength, _mm256_i32gather_epi32(wordLengths[0], row, 4), advance);
+      __m256i const next = _mm256_min_epi32(Add(word, _mm256_set1_epi32(1)), _mm256_set1_epi32(static_cast<int>(nWords)));
+      nextSlot = _mm256_blendv_epi8(
+          nextSlot, _mm256_i32gather_epi32(wordSlots[0], Add(_mm256_slli_epi32(next, 3), lanes), 4), advance);
+      nextHead = _mm256_blendv_epi8(nextHead, _mm256_i32gather_epi32(slots, nextSlot, 1), advance);
+    }
+
+    if (block < minBlocks) {
+      Compress(state, w);
+      continue;
+    }
+
+    // Past the end of some of the lanes, which keep their state.
+    __m256i next[8];
+    std::memcpy(next, state, sizeof state);
+    Compress(next, w);
+    __m256i const live = _mm256_cmpgt_epi32(nBlocks, _mm256_set1_epi32(block));
+    for (unsigned i = 0; i < 8; ++i) {
+      state[i] = _mm256_blendv_epi8(state[i], next[i], live);
+    }
+  }
+
+  Transpose(state);
+  for (unsigned lane = 0; lane < n; ++lane) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(secretKeys[lane].data()), ByteSwap(state[lane]));
+  }
+}
+
+}  // namespace
+
+void HashPassphrases(SecretKey *secretKeys, unsigned const *wordIndices, unsigned nWords, std::size_t n) {
+  if (nWords > MaxWords) {
+    for (std::size_t i = 0; i < n; ++i) {
+      HashPassphrase(wordIndices + i * nWords, nWords, secretKeys[i]);
+    }
+    return;
+  }
+
+  for (std::size_t first = 0; first < n; first += nLanes) {
+    Hash8(secretKeys + first, wordIndices + first * nWords, nWords, std::min<std::size_t>(n - first, nLanes));
+  }
+}
+
+char const *HashPassphrasesKernel(unsigned nWords) {
+  return nWords > MaxWords ? "sha256-stream" : "sha256-x8";
+}
+
+#else
+
+void HashPassphrases(SecretKey *secretKeys, unsigned const *wordIndices, unsigned nWords, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    HashPassphrase(wordIndices + i * nWords, nWords, secretKeys[i]);
+  }
+}
+
+char const *HashPassphrasesKernel(unsigned) {
+  return "sha256-stream";
+}
+
+#endif
+
+namespace {
+
+void HashPassphrasesStream(SecretKey *secretKeys, unsigned const *wordIndices, unsigned nWords, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    HashPassphrase(wordIndices + i * nWords, nWords, secretKeys[i]);
+  }
+}
+
+}  // namespace
+
+HashKernel const HashKernels[] = {
+  {"sha256-x8", "eight passphrases per AVX2 compression, the stream one without AVX2", HashPassphrases},
+  {"sha256-stream", "one passphrase at a time through the scalar SHA-256", HashPassphrasesStream},
+};
+
+std::size_t const nHashKernels = sizeof HashKernels / sizeof HashKernels[0];
+
+HashKernel const *FindHashKernel(std::string const &name) {
+  if (name.empty()) {
+    return &HashKernels[0];
+  }
+  for (auto const &kernel : HashKernels) {
+    if (name == kernel.name) {
+      return &kernel;
+    }
+  }
+  return nullptr;
+}
+
+char const *HashKernelName(HashKernel const &kernel, unsigned nWords) {
+  return kernel.hash == HashPassphrases ? HashPassphrasesKernel(nWords) : kernel.name;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "main.hxx"
+
+// SHA-256 of `n` passphrases of `nWords` words each (word indices back to
+// back), eight at a time on AVX2.
+//
+// The message words are gathered straight from a packed copy of the
+// dictionary into the structure-of-arrays layout of the compressor: every
+// word sits in a zero-padded 16-byte slot with its trailing whitespace, each
+// lane walks its words by a running sum of their lengths, and message word i
+// of the eight lanes is one gather from the current words plus the head of
+// the next ones (a gather per new word), masked and shifted by how much of
+// the current word is left. The 0x80 replaces the last whitespace and the
+// length in bits lands in word 15 of each lane's last block. Lanes whose
+// passphrase takes fewer blocks than the longest one of the eight keep their
+// state through the extra rounds.
+//
+// Without AVX2 (or for more words than the wallets have) it is the scalar
+// `HashPassphrase()` in a loop.
+void HashPassphrases(SecretKey *secretKeys, unsigned const *wordIndices, unsigned nWords, std::size_t n);
+
+// Which of the two the passphrases of `nWords` words go through, for reports.
+char const *HashPassphrasesKernel(unsigned nWords);
+
+// The hash kernels `--hash-kernel` picks from: the x8 one above, and the
+// scalar stream it falls back to, on its own.
+struct HashKernel {
+  char const *name;
+  char const *description;
+  void (*hash)(SecretKey *secretKeys, unsigned const *wordIndices, unsigned nWords, std::size_t n);
+};
+
+extern HashKernel const  HashKernels[];
+extern std::size_t const nHashKernels;
+
+// Returns nullptr for an unknown name, the x8 kernel for an empty one.
+HashKernel const *FindHashKernel(std::string const &name);
+
+// What `kernel` runs passphrases of `nWords` words through, for reports.
+char const *HashKernelName(HashKernel const &kernel, unsigned nWords);
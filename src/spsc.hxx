@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Single-producer single-consumer ring of `T`s that are handed over in
+// place: the producer fills `back()` and `push()`es it, the consumer works on
+// `front()` and `pop()`s it, so slots (and whatever they own) get reused
+// rather than copied. The indices live on cache lines of their own, and each
+// side keeps a copy of the other's index so that it only reads the shared one
+// when the ring looks full (or empty) to it.
+template <typename T, std::size_t N>
+class SpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N has to be a power of two");
+
+public:
+  explicit SpscRing(T const &prototype) : slots_(N, prototype) {}
+
+  SpscRing(SpscRing const &) = delete;
+  SpscRing &operator=(SpscRing const &) = delete;
+
+  // Producer side; null when the ring is full.
+  T *back() {
+    auto const tail = tail_.load(std::memory_order_relaxed);
+    if (tail - producerHead_ == N) {
+      producerHead_ = head_.load(std::memory_order_acquire);
+      if (tail - producerHead_ == N) {
+        return nullptr;
+      }
+    }
+    return &slots_[tail % N];
+  }
+  void push() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer side; null when the ring is empty.
+  T *front() {
+    auto const head = head_.load(std::memory_order_relaxed);
+    if (head == consumerTail_) {
+      consumerTail_ = tail_.load(std::memory_order_acquire);
+      if (head == consumerTail_) {
+        return nullptr;
+      }
+    }
+    return &slots_[head % N];
+  }
+  void pop() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+private:
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t                          consumerTail_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t                          producerHead_{0};
+  alignas(64) std::vector<T>           slots_;
+};
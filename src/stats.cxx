@@ -0,0 +1,283 @@
+#include "stats.hxx"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+
+#include <gsl/gsl>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::size_t const CacheLine = 64;
+
+static_assert(std::atomic<double>::is_always_lock_free, "shared across processes");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared across processes");
+
+// Version 2 of the layout: the header, then a cache line per worker.
+struct Header {
+  std::atomic<std::uint32_t> magic;  // stored last, with release
+  std::uint32_t              version;
+  std::uint32_t              nThreads;
+  std::uint32_t              nWords;
+  std::int64_t               pid;
+  double                     startedAt;  // unix time, seconds
+  std::uint64_t              keyspace;
+  char                       curveBackend[32];
+  char                       hashKernel[32];
+
+  alignas(CacheLine)
+  std::atomic<std::uint32_t> sequence;
+  std::atomic<std::uint32_t> state;
+  std::atomic<std::uint32_t> activeThreads;
+  std::atomic<double>        uptime;
+  std::atomic<double>        rate;
+  std::atomic<std::uint64_t> tries;
+  std::atomic<std::uint64_t> position;
+  std::atomic<double>        heartbeat;  // unix time of the last publish, outside the seqlock
+};
+
+struct alignas(CacheLine) Thread {
+  std::atomic<std::uint64_t> tries;
+};
+
+// How long a reader waits for the writer to finish an update before it calls
+// the segment torn (its writer died half way through one, say).
+std::chrono::milliseconds const TornAfter{100};
+
+// A writer that has not published for this long is taken for gone. It
+// publishes several times a second while it runs.
+double const HeartbeatTimeout = 5;  // seconds
+
+double UnixTime() {
+  return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::size_t const HeaderSize = (sizeof(Header) + CacheLine - 1) / CacheLine * CacheLine;
+
+Thread *Threads(void *memory) {
+  return reinterpret_cast<Thread *>(static_cast<char *>(memory) + HeaderSize);
+}
+
+std::string ShmPath(std::string const &name) {
+  return "/dev/shm/" + name;
+}
+
+void CopyName(char (&to)[32], std::string const &from) {
+  auto const size = std::min(from.size(), sizeof to - 1);
+  std::memcpy(to, from.data(), size);
+  to[size] = '\0';
+}
+
+char const *StateName(std::uint32_t state) {
+  switch (static_cast<StatsSegment::State>(state)) {
+    case StatsSegment::State::Running:   return "running";
+    case StatsSegment::State::Hit:       return "hit";
+    case StatsSegment::State::Exhausted: return "exhausted";
+    case StatsSegment::State::Stopped:   return "stopped";
+  }
+  return "unknown";
+}
+
+// Label values may not hold a raw quote, backslash or newline.
+std::string Escape(char const *value) {
+  std::string escaped;
+  for (; *value; ++value) {
+    if (*value == '"' || *value == '\\') {
+      escaped += '\\';
+      escaped += *value;
+    } else if (*value == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += *value;
+    }
+  }
+  return escaped;
+}
+
+void Metric(std::ostream &out, char const *name, char const *type, char const *help) {
+  out << "# HELP burst_passphrase_" << name << ' ' << help << '\n'
+      << "# TYPE burst_passphrase_" << name << ' ' << type << '\n';
+}
+
+}  // namespace
+
+StatsSegment::StatsSegment(std::string const &name, Info const &info)
+    : size_(HeaderSize + std::size_t{info.nThreads} * sizeof(Thread)) {
+  if (!name.empty()) {
+    // Truncating first zeroes whatever a previous run left there, so that a
+    // reader never takes its magic for ours.
+    auto const path = ShmPath(name);
+    int const  fd   = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd >= 0 && ftruncate(fd, 0) == 0 && ftruncate(fd, static_cast<off_t>(size_)) == 0) {
+      memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (memory_ != MAP_FAILED) {
+        path_ = path;
+      }
+    }
+    if (path_.empty()) {
+      std::cerr << "Warning: can't publish stats to " << path << ": " << std::strerror(errno) << '\n';
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  if (path_.empty()) {
+    memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory_ == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+  }
+
+  auto *header = new (memory_) Header{};
+  for (unsigned i = 0; i < info.nThreads; ++i) {
+    new (&Threads(memory_)[i]) Thread{};
+  }
+  header->version   = Version;
+  header->nThreads  = info.nThreads;
+  header->nWords    = info.nWords;
+  header->pid       = getpid();
+  header->startedAt = UnixTime();
+  header->heartbeat.store(header->startedAt, std::memory_order_relaxed);
+  header->keyspace  = info.keyspace;
+  CopyName(header->curveBackend, info.curveBackend);
+  CopyName(header->hashKernel, info.hashKernel);
+  header->magic.store(Magic, std::memory_order_release);
+}
+
+StatsSegment::~StatsSegment() {
+  // The file stays behind with the final numbers; the next run of the same
+  // name takes it over.
+  munmap(memory_, size_);
+}
+
+std::atomic<std::uint64_t> &StatsSegment::threadTries(unsigned thread) {
+  auto const *header = static_cast<Header const *>(memory_);
+  Expects(thread < header->nThreads);
+  return Threads(memory_)[thread].tries;
+}
+
+void StatsSegment::publish(Snapshot const &snapshot) {
+  auto *header = static_cast<Header *>(memory_);
+
+  auto const sequence = header->sequence.load(std::memory_order_relaxed);
+  header->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  header->state.store(static_cast<std::uint32_t>(snapshot.state), std::memory_order_relaxed);
+  header->activeThreads.store(snapshot.activeThreads, std::memory_order_relaxed);
+  header->uptime.store(snapshot.uptime, std::memory_order_relaxed);
+  header->rate.store(snapshot.rate, std::memory_order_relaxed);
+  header->tries.store(snapshot.tries, std::memory_order_relaxed);
+  header->position.store(snapshot.position, std::memory_order_relaxed);
+
+  header->sequence.store(sequence + 2, std::memory_order_release);
+  header->heartbeat.store(UnixTime(), std::memory_order_relaxed);
+}
+
+bool DumpStats(std::string const &name, std::ostream &out) {
+  auto const path = ShmPath(name);
+  int const  fd   = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Can't open " << path << ": " << std::strerror(errno) << '\n';
+    return false;
+  }
+  struct stat status;
+  void *memory = MAP_FAILED;
+  std::size_t size = 0;
+  if (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) >= HeaderSize) {
+    size   = static_cast<std::size_t>(status.st_size);
+    memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (memory == MAP_FAILED) {
+    std::cerr << "Not a stats segment: " << path << '\n';
+    return false;
+  }
+  auto const unmap = gsl::finally([memory, size] { munmap(memory, size); });
+
+  auto const *header = static_cast<Header const *>(memory);
+  if (header->magic.load(std::memory_order_acquire) != StatsSegment::Magic
+      || header->version != StatsSegment::Version
+      || size < HeaderSize + std::size_t{header->nThreads} * sizeof(Thread)) {
+    std::cerr << "Not a version " << StatsSegment::Version << " stats segment: " << path << '\n';
+    return false;
+  }
+
+  // The writer holds the sequence odd for a few stores only, unless it died
+  // in between.
+  std::uint32_t state, activeThreads;
+  double        uptime, rate;
+  std::uint64_t tries, position;
+  auto const    tornAt = std::chrono::steady_clock::now() + TornAfter;
+  for (;;) {
+    auto const sequence = header->sequence.load(std::memory_order_acquire);
+    if (sequence % 2 == 0) {
+      state         = header->state.load(std::memory_order_relaxed);
+      activeThreads = header->activeThreads.load(std::memory_order_relaxed);
+      uptime        = header->uptime.load(std::memory_order_relaxed);
+      rate          = header->rate.load(std::memory_order_relaxed);
+      tries         = header->tries.load(std::memory_order_relaxed);
+      position      = header->position.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (header->sequence.load(std::memory_order_relaxed) == sequence) {
+        break;
+      }
+    }
+    if (std::chrono::steady_clock::now() >= tornAt) {
+      std::cerr << "Torn stats segment: " << path << " stayed mid-update for " << TornAfter.count() << " ms\n";
+      return false;
+    }
+    std::this_thread::yield();
+  }
+
+  // A segment whose writer is gone still reads, with its last numbers. The
+  // heartbeat rather than the pid tells: a pid means nothing from another
+  // pid namespace (a sidecar container, say).
+  double const heartbeat = header->heartbeat.load(std::memory_order_relaxed);
+  bool const   alive     = UnixTime() - heartbeat < HeartbeatTimeout;
+
+  Metric(out, "info", "gauge", "The search and the kernels it runs.");
+  out << "burst_passphrase_info{curve_backend=\"" << Escape(header->curveBackend)
+      << "\",hash_kernel=\"" << Escape(header->hashKernel)
+      << "\",words=\"" << header->nWords
+      << "\",mode=\"" << (header->keyspace ? "enumerate" : "random")
+      << "\",pid=\"" << header->pid << "\"} 1\n";
+  Metric(out, "up", "gauge", "Whether the process that writes the segment published lately.");
+  out << "burst_passphrase_up " << (alive ? 1 : 0) << '\n';
+  Metric(out, "heartbeat_seconds", "gauge", "Unix time the segment was last published at.");
+  out << "burst_passphrase_heartbeat_seconds " << std::fixed << heartbeat << std::defaultfloat << '\n';
+  Metric(out, "state", "gauge", "1 for the state the search is in.");
+  for (std::uint32_t s = 0; s <= static_cast<std::uint32_t>(StatsSegment::State::Stopped); ++s) {
+    out << "burst_passphrase_state{state=\"" << StateName(s) << "\"} " << (s == state ? 1 : 0) << '\n';
+  }
+  Metric(out, "start_time_seconds", "gauge", "Unix time the search started at.");
+  out << "burst_passphrase_start_time_seconds " << std::fixed << header->startedAt << std::defaultfloat << '\n';
+  Metric(out, "uptime_seconds", "gauge", "Seconds the search has been running for.");
+  out << "burst_passphrase_uptime_seconds " << uptime << '\n';
+  Metric(out, "tries_total", "counter", "Passphrases tried.");
+  out << "burst_passphrase_tries_total " << tries << '\n';
+  Metric(out, "thread_tries_total", "counter", "Passphrases tried, per worker thread.");
+  for (std::uint32_t i = 0; i < header->nThreads; ++i) {
+    out << "burst_passphrase_thread_tries_total{thread=\"" << i << "\"} "
+        << Threads(memory)[i].tries.load(std::memory_order_relaxed) << '\n';
+  }
+  Metric(out, "rate", "gauge", "Passphrases tried per second lately.");
+  out << "burst_passphrase_rate " << rate << '\n';
+  Metric(out, "threads", "gauge", "Worker threads running, parked ones left out.");
+  out << "burst_passphrase_threads " << activeThreads << '\n';
+  if (header->keyspace) {
+    Metric(out, "keyspace", "gauge", "Passphrases of the enumeration.");
+    out << "burst_passphrase_keyspace " << header->keyspace << '\n';
+    Metric(out, "position", "gauge", "Passphrases of the enumeration handed out to the workers.");
+    out << "burst_passphrase_position " << position << '\n';
+  }
+  return true;
+}
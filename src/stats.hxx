@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Live counters of a run in /dev/shm/<name>, for a monitoring sidecar to read
+// without going through stdout or slowing the workers down.
+//
+// Every worker owns one cache line of the segment and stores its tries there
+// relaxed, where it would otherwise keep them anyway. The rest (totals, rate,
+// enumeration position, uptime) is published by the reporting loop of `Run()`
+// a few times a second under a seqlock: the sequence is odd while an update is
+// under way, and readers retry until they see the same even value on both
+// sides of their read, or call the segment torn when it stays odd. Each
+// publish also stamps a heartbeat, by which readers tell a live writer from a
+// gone one. The layout is versioned; a reader that finds another magic or
+// version gives up rather than misread it.
+//
+// Without a name the same layout lives in private memory, so the engine has a
+// single code path either way.
+class StatsSegment {
+public:
+  static std::uint32_t const Magic   = 0x50425453;  // "STBP"
+  static std::uint32_t const Version = 2;
+
+  enum class State : std::uint32_t { Running, Hit, Exhausted, Stopped };
+
+  // Written once, before the segment is published.
+  struct Info {
+    unsigned      nThreads;
+    unsigned      nWords;
+    std::uint64_t keyspace;  // 0 for the random search
+    std::string   curveBackend;
+    std::string   hashKernel;
+  };
+
+  // What the reporting loop publishes.
+  struct Snapshot {
+    State         state;
+    unsigned      activeThreads;
+    double        uptime;     // seconds
+    double        rate;       // tries/s lately
+    std::uint64_t tries;
+    std::uint64_t position;   // passphrases handed out by the enumeration
+  };
+
+  StatsSegment(std::string const &name, Info const &info);
+  ~StatsSegment();
+
+  StatsSegment(StatsSegment const &) = delete;
+  StatsSegment &operator=(StatsSegment const &) = delete;
+
+  // The tries counter of worker `thread`, for it alone to store to.
+  std::atomic<std::uint64_t> &threadTries(unsigned thread);
+
+  void publish(Snapshot const &snapshot);
+
+  // The path of the segment, empty for a private one.
+  std::string const &path() const { return path_; }
+
+private:
+  std::string path_;
+  std::size_t size_;
+  void       *memory_;
+};
+
+// Renders segment `name` in the Prometheus text exposition format, e.g. for
+// the textfile collector of the node exporter. Returns false (having said why
+// on stderr) when there is no such segment or it is not one we can read.
+bool DumpStats(std::string const &name, std::ostream &out);
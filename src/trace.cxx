@@ -0,0 +1,115 @@
+#include "trace.hxx"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace {
+
+char const *Name(TraceRing::Kind kind) {
+  switch (kind) {
+    case TraceRing::Kind::Batch:     return "batch";
+    case TraceRing::Kind::Sha256:    return "sha256";
+    case TraceRing::Kind::X25519:    return "x25519";
+    case TraceRing::Kind::Chunk:     return "chunk";
+    case TraceRing::Kind::Steal:     return "steal";
+    case TraceRing::Kind::Parked:    return "parked";
+    case TraceRing::Kind::Migration: return "migration";
+  }
+  return "unknown";
+}
+
+char const *ArgName(TraceRing::Kind kind) {
+  switch (kind) {
+    case TraceRing::Kind::Batch:
+    case TraceRing::Kind::Sha256:
+    case TraceRing::Kind::X25519:    return "keys";
+    case TraceRing::Kind::Chunk:     return "passphrases";
+    case TraceRing::Kind::Steal:     return "victim";
+    case TraceRing::Kind::Parked:    return "active";
+    case TraceRing::Kind::Migration: return "from";
+  }
+  return "arg";
+}
+
+// Trace timestamps are in microseconds; keep the nanoseconds as decimals.
+void Microseconds(std::ostream &out, std::uint64_t ns) {
+  out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+}
+
+}  // namespace
+
+Trace::Trace(std::string path, unsigned nThreads, std::size_t capacity)
+    : path_(std::move(path)), startedAt_(std::chrono::steady_clock::now()) {
+  for (unsigned i = 0; i < nThreads; ++i) {
+    rings_.push_back(std::make_unique<TraceRing>(capacity));
+  }
+}
+
+std::size_t Trace::events() const {
+  std::size_t n = 0;
+  for (auto const &ring : rings_) {
+    n += ring->size();
+  }
+  return n;
+}
+
+std::size_t Trace::dropped() const {
+  std::size_t n = 0;
+  for (auto const &ring : rings_) {
+    n += ring->dropped();
+  }
+  return n;
+}
+
+bool Trace::write() const {
+  std::ofstream out(path_);
+  if (out) {
+    write(out);
+  }
+  if (!out) {
+    std::cerr << "Can't write the trace to " << path_ << ": " << std::strerror(errno) << '\n';
+    return false;
+  }
+  return true;
+}
+
+void Trace::write(std::ostream &out) const {
+  auto const pid = getpid();
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"burst passphrase search\"}}";
+  for (std::size_t thread = 0; thread < rings_.size(); ++thread) {
+    auto const &ring = *rings_[thread];
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << thread
+        << ",\"args\":{\"name\":\"worker " << thread << "\"}}"
+        << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << thread
+        << ",\"args\":{\"sort_index\":" << thread << "}}";
+    if (ring.dropped()) {
+      out << ",\n{\"name\":\"older events dropped\",\"ph\":\"i\",\"s\":\"t\",\"pid\":" << pid << ",\"tid\":" << thread
+          << ",\"ts\":";
+      Microseconds(out, ring.size() ? ring[0].begin : 0);
+      out << ",\"args\":{\"dropped\":" << ring.dropped() << "}}";
+    }
+
+    for (std::size_t i = 0; i < ring.size(); ++i) {
+      auto const &event   = ring[i];
+      bool const  instant = event.kind == TraceRing::Kind::Chunk || event.kind == TraceRing::Kind::Steal
+                            || event.kind == TraceRing::Kind::Migration;
+      out << ",\n{\"name\":\"" << Name(event.kind) << "\",\"cat\":\"engine\",\"ph\":\"" << (instant ? "i" : "X")
+          << "\",\"pid\":" << pid << ",\"tid\":" << thread << ",\"ts\":";
+      Microseconds(out, event.begin);
+      if (instant) {
+        out << ",\"s\":\"t\"";
+      } else {
+        out << ",\"dur\":";
+        Microseconds(out, event.end - event.begin);
+      }
+      out << ",\"args\":{\"" << ArgName(event.kind) << "\":" << event.arg << ",\"cpu\":" << event.cpu << "}}";
+    }
+  }
+  out << "\n]}\n";
+}
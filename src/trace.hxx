@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Timeline of a run in the Chrome trace-event format, to open in Perfetto
+// (ui.perfetto.dev) or chrome://tracing: every batch of every worker with its
+// SHA-256 and X25519 stages and the CPU it ran on, the time spent parked, and
+// instants for migrations, enumeration chunks taken and steals.
+//
+// Each worker records into a ring of its own, so there is nothing to share
+// or lock; once it is full, the oldest events make room for the new ones.
+// The rings are only read after the workers are joined.
+class TraceRing {
+public:
+  enum class Kind : std::uint8_t { Batch, Sha256, X25519, Chunk, Steal, Parked, Migration };
+
+  struct Event {
+    std::uint64_t begin;  // ns since the trace started
+    std::uint64_t end;    // the same as `begin` for the instants
+    std::uint64_t arg;    // keys of a batch, size of a chunk, victim of a steal, CPU a migration is from
+    std::uint32_t cpu;
+    Kind          kind;
+  };
+
+  // Left uninitialized, so that only what gets written takes memory.
+  explicit TraceRing(std::size_t capacity) : events_(new Event[capacity]), capacity_(capacity) {}
+
+  void record(Kind kind, std::uint64_t begin, std::uint64_t end, std::uint64_t arg, std::uint32_t cpu) {
+    events_[written_++ % capacity_] = {begin, end, arg, cpu, kind};
+  }
+
+  std::size_t size() const { return std::min(written_, capacity_); }
+  std::size_t dropped() const { return written_ - size(); }
+  // Oldest first.
+  Event const &operator[](std::size_t i) const { return events_[(written_ - size() + i) % capacity_]; }
+
+private:
+  std::unique_ptr<Event[]> events_;
+  std::size_t              capacity_;
+  std::size_t              written_{0};
+};
+
+class Trace {
+public:
+  // Events kept per worker, the latest ones: 16 MB, some seconds of batches
+  // at full speed, more when they are bigger.
+  static std::size_t const DefaultCapacity = std::size_t{1} << 19;
+
+  Trace(std::string path, unsigned nThreads, std::size_t capacity = DefaultCapacity);
+
+  TraceRing &ring(unsigned thread) { return *rings_[thread]; }
+
+  // Nanoseconds since construction, the timestamps of the events.
+  std::uint64_t now() const {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startedAt_).count());
+  }
+
+  // Writes the JSON to the path given; false (having said why on stderr)
+  // when it can't.
+  bool write() const;
+
+  std::string const &path() const { return path_; }
+  std::size_t events() const;
+  std::size_t dropped() const;
+
+private:
+  void write(std::ostream &out) const;
+
+  std::string                              path_;
+  std::chrono::steady_clock::time_point    startedAt_;
+  std::vector<std::unique_ptr<TraceRing>>  rings_;
+};
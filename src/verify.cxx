@@ -0,0 +1,488 @@
+#include "verify.hxx"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpus.hxx"
+#include "engine.hxx"
+#include "fixedbase.hxx"
+#include "keygen.hxx"
+#include "main.hxx"
+#include "permutation.hxx"
+#include "sha256.hxx"
+#include "sha256x8.hxx"
+#include "utils.hxx"
+
+#include <gsl/gsl>
+#include <picosha2.h>
+#include <rfc7748_precompted.h>
+extern "C" {
+#include <fp25519_x64.h>
+}
+#if defined(WITH_CURVE25519_MEHDI)
+# include <curve25519_dh.h>
+#endif
+
+namespace {
+
+std::size_t const DefaultIterations = 1000000;
+
+// Every kernel is run on batches of these sizes, so that SIMD kernels get
+// their full, partial and odd tails checked.
+std::size_t const BatchSizes[] = {1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 31, 64};
+std::size_t const MaxBatchSize = 64;
+
+// How many mismatches to print before just counting them.
+unsigned const MaxReported = 10;
+
+std::array<unsigned char, 32> const BasePoint = {{9}};
+
+// Keygen kernels are the curve backends of the engine, plus whatever else
+// is worth cross-checking.
+struct KeyGenKernel {
+  char const *name;
+  void (*generate)(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n);
+};
+
+// The vartime backend runs with whatever `--table-bits` says, so every other
+// window gets checked too.
+template <unsigned WindowBits>
+void VartimeKernel(PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) {
+  static FixedBaseTable const table(WindowBits);
+  table.generate(publicKeys, secretKeys, n);
+}
+
+std::vector<KeyGenKernel> KeyGenKernels() {
+  std::vector<KeyGenKernel> kernels;
+  for (std::size_t i = 0; i < nKeyGenBackends; ++i) {
+    kernels.push_back({KeyGenBackends[i].name, KeyGenBackends[i].generate});
+  }
+  static_assert(FixedBaseTable::MinWindowBits == 2 && FixedBaseTable::MaxWindowBits == 8,
+                "keep the list below in sync");
+  kernels.push_back({"vartime-w2", VartimeKernel<2>});
+  kernels.push_back({"vartime-w3", VartimeKernel<3>});
+  kernels.push_back({"vartime-w4", VartimeKernel<4>});
+  kernels.push_back({"vartime-w5", VartimeKernel<5>});
+  kernels.push_back({"vartime-w6", VartimeKernel<6>});
+  kernels.push_back({"vartime-w7", VartimeKernel<7>});
+  kernels.push_back({"vartime-w8", VartimeKernel<8>});
+#if defined(WITH_CURVE25519_MEHDI)
+  // Against the mehdi reference this is rather a check of the reference
+  // itself: the ladder is a different algorithm of a different library.
+  kernels.push_back({"rfc7748-ladder", [](PublicKey *publicKeys, SecretKey const *secretKeys, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      auto basePoint = BasePoint;
+      auto secretKey = secretKeys[i];
+      X25519_Shared_x64(publicKeys[i].data(), basePoint.data(), secretKey.data());
+    }
+  }});
+#endif
+  return kernels;
+}
+
+PublicKey ReferencePublicKey(SecretKey secretKey) {
+  PublicKey publicKey;
+#if defined(WITH_CURVE25519_MEHDI)
+  curve25519_dh_CalculatePublicKey(publicKey.data(), secretKey.data());
+#else
+  auto basePoint = BasePoint;
+  X25519_Shared_x64(publicKey.data(), basePoint.data(), secretKey.data());
+#endif
+  return publicKey;
+}
+
+SecretKey ReferenceHash(unsigned const *wordIndices, unsigned nWords) {
+  std::string const passphrase = PassphraseString(std::vector<unsigned>(wordIndices, wordIndices + nWords));
+
+  SecretKey secretKey;
+  picosha2::hash256(passphrase.cbegin(), passphrase.cend(), secretKey.begin(), secretKey.end());
+  return secretKey;
+}
+
+// Little-endian 256-bit integers for the edge cases.
+using Scalar = std::array<unsigned char, 32>;
+
+Scalar AddSmall(Scalar a, int k) {
+  int carry = k;
+  for (auto &byte : a) {
+    int const sum = byte + carry;
+    byte  = static_cast<unsigned char>(sum & 0xff);
+    carry = sum >> 8;  // arithmetic shift, borrows come out as -1
+  }
+  return a;
+}
+
+Scalar MulSmall(Scalar a, unsigned k) {
+  unsigned carry = 0;
+  for (auto &byte : a) {
+    unsigned const product = byte * k + carry;
+    byte  = static_cast<unsigned char>(product & 0xff);
+    carry = product >> 8;
+  }
+  return a;
+}
+
+// Scalars around zero, the group order and the field prime, their small
+// multiples, single bits and single holes, and a few byte patterns.
+std::vector<SecretKey> EdgeCaseScalars() {
+  // 2^252 + 27742317777372353535851937790883648493
+  Scalar const L = {{
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+  }};
+  // 2^255 - 19
+  Scalar P;
+  P.fill(0xff);
+  P[0]  = 0xed;
+  P[31] = 0x7f;
+
+  std::vector<SecretKey> scalars;
+  for (auto const &base : {Scalar{}, L, P}) {
+    for (int k = -8; k <= 8; ++k) {
+      scalars.push_back(AddSmall(base, k));
+    }
+  }
+  for (unsigned k = 2; k <= 8; ++k) {
+    scalars.push_back(MulSmall(L, k));
+  }
+  for (unsigned bit = 0; bit < 256; ++bit) {
+    Scalar single{};
+    single[bit / 8] = static_cast<unsigned char>(1u << (bit % 8));
+    scalars.push_back(single);
+
+    Scalar hole;
+    hole.fill(0xff);
+    hole[bit / 8] ^= single[bit / 8];
+    scalars.push_back(hole);
+  }
+  for (unsigned char const pattern : {0x55, 0xaa, 0x0f, 0xf0, 0x80, 0x7f}) {
+    Scalar repeated;
+    repeated.fill(pattern);
+    scalars.push_back(repeated);
+  }
+
+  return scalars;
+}
+
+// Field elements around 0, p and 2^256 for the inversion, non-canonical
+// representations included: the field code works on anything below 2^256.
+std::vector<Scalar> EdgeCaseFieldElements() {
+  Scalar P;
+  P.fill(0xff);
+  P[0]  = 0xed;
+  P[31] = 0x7f;
+  Scalar Top;
+  Top.fill(0xff);
+
+  std::vector<Scalar> elements;
+  for (int k = 0; k <= 20; ++k) {
+    elements.push_back(AddSmall(Scalar{}, k));
+    elements.push_back(AddSmall(P, k - 10));
+    elements.push_back(AddSmall(Top, -k));
+  }
+  return elements;
+}
+
+// One passphrase of every reachable length for every word count, the lengths
+// that straddle the SHA-256 padding boundaries (55/56/64 bytes and so on)
+// included.
+std::vector<std::vector<unsigned>> LengthBucketPassphrases(std::mt19937_64 &gen) {
+  unsigned const MinLength = 3, MaxLength = 12;
+
+  std::vector<unsigned> byLength[MaxLength + 1];
+  for (unsigned i = 0; i < DictSize; ++i) {
+    byLength[Words[i].size()].push_back(i);
+  }
+
+  std::vector<std::vector<unsigned>> passphrases;
+  for (unsigned nWords = 1; nWords <= nWallets; ++nWords) {
+    for (unsigned letters = MinLength * nWords; letters <= MaxLength * nWords; ++letters) {
+      // Start with the shortest words and lengthen random ones up to `letters`.
+      std::vector<unsigned> lengths(nWords, MinLength);
+      for (unsigned extra = letters - MinLength * nWords; extra > 0; ) {
+        auto &length = lengths[std::uniform_int_distribution<unsigned>(0, nWords - 1)(gen)];
+        if (length < MaxLength) {
+          ++length;
+          --extra;
+        }
+      }
+
+      std::vector<unsigned> wordIndices;
+      for (auto const length : lengths) {
+        auto const &candidates = byLength[length];
+        wordIndices.push_back(candidates[std::uniform_int_distribution<std::size_t>(0, candidates.size() - 1)(gen)]);
+      }
+      passphrases.push_back(wordIndices);
+    }
+  }
+
+  return passphrases;
+}
+
+class Checker {
+ public:
+  // `describe()` renders the input, it is only called on a mismatch.
+  template <typename Describe>
+  void check(char const *stage, char const *kernel, std::size_t batchSize, std::size_t lane,
+             Describe &&describe,
+             std::array<unsigned char, 32> const &expected,
+             std::array<unsigned char, 32> const &actual) {
+    checks_.fetch_add(1, std::memory_order_relaxed);
+    if (expected == actual) {
+      return;
+    }
+
+    auto const n = mismatches_.fetch_add(1, std::memory_order_relaxed);
+    if (n >= MaxReported) {
+      return;
+    }
+    std::lock_guard<std::mutex> printingLock(printingMutex_);
+    std::cout << "verify: MISMATCH in " << stage << ' ' << kernel
+              << " (batch of " << batchSize << ", lane " << lane << ")\n"
+              << "  input:    " << describe() << '\n'
+              << "  expected: " << to_hexstring(expected) << '\n'
+              << "  actual:   " << to_hexstring(actual) << '\n';
+  }
+
+  std::size_t checks() const     { return checks_.load(); }
+  std::size_t mismatches() const { return mismatches_.load(); }
+
+ private:
+  std::atomic<std::size_t> checks_{0};
+  std::atomic<std::size_t> mismatches_{0};
+  std::mutex               printingMutex_;
+};
+
+// Runs every keygen kernel on `secretKeys` in batches of `batchSize`.
+void CheckKeyGen(Checker &checker, std::vector<SecretKey> const &secretKeys, std::size_t batchSize) {
+  std::vector<PublicKey> expected;
+  for (auto const &secretKey : secretKeys) {
+    expected.push_back(ReferencePublicKey(secretKey));
+  }
+
+  for (auto const &kernel : KeyGenKernels()) {
+    for (std::size_t first = 0; first < secretKeys.size(); first += batchSize) {
+      auto const n = std::min(batchSize, secretKeys.size() - first);
+
+      std::array<PublicKey, MaxBatchSize> output;
+      kernel.generate(output.data(), &secretKeys[first], n);
+
+      for (std::size_t lane = 0; lane < n; ++lane) {
+        auto const &secretKey = secretKeys[first + lane];
+        checker.check("x25519", kernel.name, n, lane, [&secretKey] { return to_hexstring(secretKey); },
+                      expected[first + lane], output[lane]);
+      }
+    }
+  }
+}
+
+// The variable-time inversion against the Fermat one.
+void CheckInversion(Checker &checker, std::vector<Scalar> const &elements) {
+  for (auto const &element : elements) {
+    EltFp25519_1w_x64 a, expected, actual;
+    std::memcpy(a, element.data(), sizeof a);
+    inv_EltFp25519_1w_x64(expected, a);
+    fred_EltFp25519_1w_x64(expected);
+    inv_var_EltFp25519_1w_x64(actual, a);
+
+    std::array<unsigned char, 32> expectedBytes, actualBytes;
+    std::memcpy(expectedBytes.data(), expected, sizeof expected);
+    std::memcpy(actualBytes.data(), actual, sizeof actual);
+    checker.check("inverse", "safegcd", 1, 0, [&element] { return to_hexstring(element); },
+                  expectedBytes, actualBytes);
+  }
+}
+
+// Runs every hash kernel on `passphrases` (all of `nWords` words) in batches of `batchSize`.
+void CheckHash(Checker &checker, std::vector<unsigned> const &wordIndices, unsigned nWords,
+               std::size_t batchSize) {
+  auto const count = wordIndices.size() / nWords;
+
+  std::vector<SecretKey> expected;
+  for (std::size_t i = 0; i < count; ++i) {
+    expected.push_back(ReferenceHash(&wordIndices[i * nWords], nWords));
+  }
+
+  for (auto const &kernel : gsl::make_span(HashKernels, nHashKernels)) {
+    for (std::size_t first = 0; first < count; first += batchSize) {
+      auto const n = std::min(batchSize, count - first);
+
+      std::array<SecretKey, MaxBatchSize> output;
+      kernel.hash(output.data(), &wordIndices[first * nWords], nWords, n);
+
+      for (std::size_t lane = 0; lane < n; ++lane) {
+        auto const *passphrase = &wordIndices[(first + lane) * nWords];
+        auto const  describe   = [passphrase, nWords] {
+          return '"' + PassphraseString(std::vector<unsigned>(passphrase, passphrase + nWords)) + '"';
+        };
+
+        checker.check("sha256", kernel.name, n, lane, describe, expected[first + lane], output[lane]);
+      }
+    }
+  }
+}
+
+// The streaming hasher on its own: messages of every length up to a few
+// blocks, fed in random pieces, against picosha2 in one go.
+void CheckSha256Streaming(Checker &checker, std::mt19937_64 &gen) {
+  std::size_t const MaxLength = 300;
+  std::uniform_int_distribution<unsigned> byte(0, 0xff);
+
+  Sha256 hasher;
+  for (std::size_t length = 0; length <= MaxLength; ++length) {
+    std::vector<unsigned char> message(length);
+    for (auto &b : message) {
+      b = static_cast<unsigned char>(byte(gen));
+    }
+
+    SecretKey expected;
+    picosha2::hash256(message.cbegin(), message.cend(), expected.begin(), expected.end());
+
+    SecretKey actual;
+    hasher.reset();
+    for (std::size_t fed = 0; fed < length; ) {
+      auto const piece = std::uniform_int_distribution<std::size_t>(0, length - fed)(gen);
+      hasher.update({message.data() + fed, static_cast<std::ptrdiff_t>(piece)});
+      fed += piece;
+    }
+    hasher.final(actual);
+
+    checker.check("sha256", "sha256-chunked", 1, 0, [&message] { return to_hexstring(message); },
+                  expected, actual);
+  }
+}
+
+// The `--permute` order has to hit every passphrase once: count the distinct
+// in-range outputs over whole keyspaces of 1 and 2 words, and a few sizes
+// that are awkward for the Feistel halves.
+void CheckPermutation(Checker &checker, std::mt19937_64 &gen) {
+  std::uint64_t const sizes[] = {1, 2, 3, DictSize, DictSize * DictSize, 1000003};
+  for (auto const size : sizes) {
+    for (auto const key : {std::uint64_t{0}, std::uint64_t{gen()}}) {
+      KeyspacePermutation const permutation(size, key);
+      std::vector<bool>         seen(size);
+      std::uint64_t             distinct = 0;
+      for (std::uint64_t i = 0; i < size; ++i) {
+        auto const index = permutation(i);
+        if (index < size && !seen[index]) {
+          seen[index] = true;
+          ++distinct;
+        }
+      }
+
+      std::array<unsigned char, 32> expected{}, actual{};
+      std::memcpy(expected.data(), &size, sizeof size);
+      std::memcpy(actual.data(), &distinct, sizeof distinct);
+      checker.check("permutation", "feistel", 1, 0,
+                    [size, key] { return "[0, " + std::to_string(size) + ") key " + std::to_string(key); },
+                    expected, actual);
+    }
+  }
+}
+
+void CheckEdgeCases(Checker &checker, std::mt19937_64 &gen) {
+  CheckSha256Streaming(checker, gen);
+  CheckPermutation(checker, gen);
+
+  auto const scalars = EdgeCaseScalars();
+  for (auto const batchSize : BatchSizes) {
+    CheckKeyGen(checker, scalars, batchSize);
+  }
+  CheckInversion(checker, EdgeCaseFieldElements());
+
+  // Group the length buckets by word count, since a batch shares the word count.
+  auto const passphrases = LengthBucketPassphrases(gen);
+  for (unsigned nWords = 1; nWords <= nWallets; ++nWords) {
+    std::vector<unsigned> wordIndices;
+    for (auto const &passphrase : passphrases) {
+      if (passphrase.size() == nWords) {
+        wordIndices.insert(wordIndices.end(), passphrase.cbegin(), passphrase.cend());
+      }
+    }
+    for (auto const batchSize : BatchSizes) {
+      CheckHash(checker, wordIndices, nWords, batchSize);
+    }
+  }
+}
+
+void CheckRandom(Checker &checker, std::mt19937_64 gen, std::size_t iterations) {
+  std::uniform_int_distribution<unsigned> byte(0, 0xff);
+  std::uniform_int_distribution<unsigned> word(0, DictSize - 1);
+  std::uniform_int_distribution<unsigned> nWordsDis(1, nWallets);
+
+  for (std::size_t done = 0, round = 0; done < iterations; ++round) {
+    auto const batchSize = std::min(BatchSizes[round % std::size(BatchSizes)], iterations - done);
+
+    std::vector<SecretKey> secretKeys(batchSize);
+    for (auto &secretKey : secretKeys) {
+      for (auto &b : secretKey) {
+        b = static_cast<unsigned char>(byte(gen));
+      }
+    }
+    CheckKeyGen(checker, secretKeys, batchSize);
+    CheckInversion(checker, secretKeys);
+
+    unsigned const        nWords = nWordsDis(gen);
+    std::vector<unsigned> wordIndices(batchSize * nWords);
+    for (auto &wordIndex : wordIndices) {
+      wordIndex = word(gen);
+    }
+    CheckHash(checker, wordIndices, nWords, batchSize);
+
+    done += batchSize;
+  }
+}
+
+}  // namespace
+
+int Verify(Options const &options) {
+  auto const iterations = options.iterations ? options.iterations : DefaultIterations;
+  auto const seed       = options.seed ? options.seed : std::random_device{}();
+  unsigned const nThreads = options.threads ? options.threads : ReadCpuBudget().threads();
+
+  std::cout << "verify: seed " << seed << "; " << iterations << " random inputs on "
+            << nThreads << " threads; reference x25519: "
+#if defined(WITH_CURVE25519_MEHDI)
+            << "mehdi curve25519\n"
+#else
+            << "rfc7748 ladder\n"
+#endif
+            << "verify: x25519 kernels:";
+  for (auto const &kernel : KeyGenKernels()) {
+    std::cout << ' ' << kernel.name;
+  }
+  std::cout << "; sha256 kernels:";
+  for (auto const &kernel : gsl::make_span(HashKernels, nHashKernels)) {
+    std::cout << ' ' << kernel.name;
+  }
+  std::cout << std::endl;
+
+  Checker checker;
+  {
+    std::mt19937_64 gen(seed);
+    CheckEdgeCases(checker, gen);
+  }
+
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < nThreads; ++i) {
+    auto const share = iterations / nThreads + (i < iterations % nThreads ? 1 : 0);
+    threads.emplace_back(CheckRandom, std::ref(checker), std::mt19937_64(seed + 1 + i), share);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  bool const passed = checker.mismatches() == 0;
+  std::cout << "verify: " << checker.checks() << " checks, " << checker.mismatches() << " mismatches\n"
+            << "verify: " << (passed ? "passed" : "FAILED") << '\n';
+  return passed ? 0 : 4;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "options.hxx"
+
+// Differential check of every SHA-256 and X25519 kernel of the engine against
+// reference implementations: picosha2 on the joined passphrase, and the
+// independent mehdi curve25519 (or, without it, the rfc7748 variable-base
+// ladder) for the keys; and the `--permute` order for being a permutation.
+// Runs `options.iterations` random inputs plus the edge cases on all the
+// CPUs, in every batch size, and compares each lane byte by byte.
+//
+// Returns the process exit code: 0 when everything agreed.
+int Verify(Options const &options);
@@ -58,6 +58,7 @@ void add_EltFp25519_1w_x64(uint64_t *const c, uint64_t *const a, uint64_t *const
 void sub_EltFp25519_1w_x64(uint64_t *const c, uint64_t *const a, uint64_t *const b);
 void mul_a24_EltFp25519_1w_x64(uint64_t *const c, uint64_t *const a);
 void inv_EltFp25519_1w_x64(uint64_t *const pC, uint64_t *const pA);
+void inv_var_EltFp25519_1w_x64(uint64_t *const pC, uint64_t *const pA);
 void fred_EltFp25519_1w_x64(uint64_t *const c);
 
 #define mul_EltFp25519_1w_x64(c,a,b)  \
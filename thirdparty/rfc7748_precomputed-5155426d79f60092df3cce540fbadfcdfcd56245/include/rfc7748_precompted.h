@@ -20,6 +20,10 @@
 
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define ALIGN_BYTES 32
 #ifdef __INTEL_COMPILER
 #define ALIGN __declspec(align(ALIGN_BYTES))
@@ -42,8 +46,14 @@ void random_X25519_key(argKey key);
 void random_X448_key(argKey key);
 
 extern const KeyGen X25519_KeyGen_x64;
+/* What X25519_KeyGen_x64 points to, for a direct call that LTO can inline. */
+void x25519_keygen_precmp_x64(argKey session_key, argKey private_key);
 extern const Shared X25519_Shared_x64;
 extern const KeyGen X448_KeyGen_x64;
 extern const Shared X448_Shared_x64;
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* RFC7748_PRECOMPUTED_H */
@@ -372,8 +372,15 @@ void red_EltFp25519_2w_x64(uint64_t *const c, uint64_t *const a)
 		"   mulx	56(%1), %%r11, %%rcx # c*C[7]      \n\t"   "  adcx	%%rax, %%r11  \n\t"  "  adox    24(%1), %%r11  \n\t"    "  movq  %%r11, 24(%0) \n\t"
 		                                                       "  adcx	%%rbx, %%rcx  \n\t"  "  adox     %%rbx, %%rcx  \n\t"
 		"   xorl    %%ebx, %%ebx                       \n\t"
-		"   mulx	%%rcx, %%rax, %%rcx                \n\t"   "  adcx  %%rax,  %%r8  \n\t"  "  movq     %%r8,   (%0)  \n\t"
-		                                                       "  adcx  %%rcx,  %%r9  \n\t"  "  movq     %%r9,  8(%0)  \n\t"
+		"   mulx	%%rcx, %%rax, %%rcx                \n\t"   "  adcx  %%rax,  %%r8  \n\t"
+		                                                       "  adcx  %%rcx,  %%r9  \n\t"
+		                                                       "  adcx  %%rbx, %%r10  \n\t"
+		                                                       "  adcx  %%rbx, %%r11  \n\t"
+		"   cmovc   %%rdx, %%rbx   # past 2^256: 38 more \n\t"
+		"   addq    %%rbx,  %%r8                       \n\t"   "  movq     %%r8,   (%0)  \n\t"
+		                                                       "  movq     %%r9,  8(%0)  \n\t"
+		                                                       "  movq    %%r10, 16(%0)  \n\t"
+		                                                       "  movq    %%r11, 24(%0)  \n\t"
 
 		"   mulx	 96(%1),  %%r8, %%r10 # c*C[4]     \n\t"   "  xorl  %%ebx, %%ebx  \n\t"  "  adox    64(%1),  %%r8  \n\t"
 		"   mulx	104(%1),  %%r9, %%r11 # c*C[5]     \n\t"   "  adcx	%%r10,  %%r9  \n\t"  "  adox    72(%1),  %%r9  \n\t"
@@ -381,8 +388,15 @@ void red_EltFp25519_2w_x64(uint64_t *const c, uint64_t *const a)
 		"   mulx	120(%1), %%r11, %%rcx # c*C[7]     \n\t"   "  adcx	%%rax, %%r11  \n\t"  "  adox    88(%1), %%r11  \n\t"    "  movq  %%r11, 56(%0) \n\t"
 		                                                       "  adcx	%%rbx, %%rcx  \n\t"  "  adox     %%rbx, %%rcx  \n\t"
 		"   xorl    %%ebx, %%ebx                       \n\t"
-		"   mulx	%%rcx, %%rax, %%rcx                \n\t"   "  adcx  %%rax,  %%r8  \n\t"  "  movq     %%r8, 32(%0)  \n\t"
-		                                                       "  adcx  %%rcx,  %%r9  \n\t"  "  movq     %%r9, 40(%0)  \n\t"
+		"   mulx	%%rcx, %%rax, %%rcx                \n\t"   "  adcx  %%rax,  %%r8  \n\t"
+		                                                       "  adcx  %%rcx,  %%r9  \n\t"
+		                                                       "  adcx  %%rbx, %%r10  \n\t"
+		                                                       "  adcx  %%rbx, %%r11  \n\t"
+		"   cmovc   %%rdx, %%rbx   # past 2^256: 38 more \n\t"
+		"   addq    %%rbx,  %%r8                       \n\t"   "  movq     %%r8, 32(%0)  \n\t"
+		                                                       "  movq     %%r9, 40(%0)  \n\t"
+		                                                       "  movq    %%r10, 48(%0)  \n\t"
+		                                                       "  movq    %%r11, 56(%0)  \n\t"
 	:
 	: "r"  (c), "r" (a)
 	: "cc", "%rax", "%rbx", "%rcx", "%rdx", "%r8", "%r9", "%r10", "%r11"
@@ -402,9 +416,17 @@ void red_EltFp25519_2w_x64(uint64_t *const c, uint64_t *const a)
         "adcq 24(%1), %%rax \n\t"     "movq	%%rax, 24(%0) \n\t"
                                       "adcq    $0, %%rcx  \n\t"
 
-        "mulx %%rcx, %%rax, %%rcx \n\t"
-        "addq %%rax, %%r8  \n\t" "movq %%r8,   (%0) \n\t"
-        "adcq %%rcx, %%r10 \n\t" "movq %%r10, 8(%0) \n\t"
+        "mulx %%rcx, %%r9, %%rcx \n\t"
+        "addq %%r9, %%r8   \n\t"
+        "adcq %%rcx, %%r10 \n\t"
+        "adcq    $0, %%r12 \n\t"
+        "adcq    $0, %%rax \n\t"
+        "movl    $0, %%ebx \n\t"
+        "cmovc %%rdx, %%rbx # past 2^256: 38 more \n\t"
+        "addq %%rbx, %%r8  \n\t" "movq %%r8,   (%0) \n\t"
+                                 "movq %%r10, 8(%0) \n\t"
+                                 "movq %%r12, 16(%0) \n\t"
+                                 "movq %%rax, 24(%0) \n\t"
 
         "mulx  96(%1), %%r8,  %%r9  # c*C[4] \n\t"
         "mulx 104(%1), %%r10, %%r11 # c*C[5] \n\t"   "addq %%r9, %%r10  \n\t"
@@ -418,9 +440,17 @@ void red_EltFp25519_2w_x64(uint64_t *const c, uint64_t *const a)
         "adcq 88(%1), %%rax \n\t"     "movq	%%rax, 56(%0) \n\t"
         "adcq     $0, %%rcx \n\t"
 
-        "mulx %%rcx, %%rax, %%rcx   \n\t"
-        "addq %%rax, %%r8  \n\t" "   movq %%r8,  32(%0) \n\t"
-        "adcq %%rcx, %%r10 \n\t" "   movq %%r10, 40(%0) \n\t"
+        "mulx %%rcx, %%r9, %%rcx \n\t"
+        "addq %%r9, %%r8   \n\t"
+        "adcq %%rcx, %%r10 \n\t"
+        "adcq    $0, %%r12 \n\t"
+        "adcq    $0, %%rax \n\t"
+        "movl    $0, %%ebx \n\t"
+        "cmovc %%rdx, %%rbx # past 2^256: 38 more \n\t"
+        "addq %%rbx, %%r8  \n\t" "movq %%r8,  32(%0) \n\t"
+                                 "movq %%r10, 40(%0) \n\t"
+                                 "movq %%r12, 48(%0) \n\t"
+                                 "movq %%rax, 56(%0) \n\t"
 
 	:
 	: "r"  (c), "r" (a)
@@ -618,8 +648,15 @@ void red_EltFp25519_1w_x64(uint64_t *const c, uint64_t *const a)
 		"   mulx	56(%1), %%r11, %%rcx # c*C[7]      \n\t"   "  adcx	%%rax, %%r11  \n\t"  "  adox    24(%1), %%r11  \n\t"    "  movq  %%r11, 24(%0) \n\t"
 		                                                       "  adcx	%%rbx, %%rcx  \n\t"  "  adox     %%rbx, %%rcx  \n\t"
 		"   xorl    %%ebx, %%ebx                       \n\t"
-		"   mulx	%%rcx, %%rax, %%rcx                \n\t"   "  adcx  %%rax,  %%r8  \n\t"  "  movq     %%r8,   (%0)  \n\t"
-		                                                       "  adcx  %%rcx,  %%r9  \n\t"  "  movq     %%r9,  8(%0)  \n\t"
+		"   mulx	%%rcx, %%rax, %%rcx                \n\t"   "  adcx  %%rax,  %%r8  \n\t"
+		                                                       "  adcx  %%rcx,  %%r9  \n\t"
+		                                                       "  adcx  %%rbx, %%r10  \n\t"
+		                                                       "  adcx  %%rbx, %%r11  \n\t"
+		"   cmovc   %%rdx, %%rbx   # past 2^256: 38 more \n\t"
+		"   addq    %%rbx,  %%r8                       \n\t"   "  movq     %%r8,   (%0)  \n\t"
+		                                                       "  movq     %%r9,  8(%0)  \n\t"
+		                                                       "  movq    %%r10, 16(%0)  \n\t"
+		                                                       "  movq    %%r11, 24(%0)  \n\t"
 	:
 	: "r"  (c), "r" (a)
 	: "memory", "cc", "%rax", "%rbx", "%rcx", "%rdx", "%r8", "%r9", "%r10", "%r11"
@@ -639,9 +676,17 @@ void red_EltFp25519_1w_x64(uint64_t *const c, uint64_t *const a)
 			"  adcq    24(%1), %%rax  \n\t"     "   movq	%%rax, 24(%0)  \n\t"
 			"  adcq        $0, %%rcx  \n\t"
 
-			"  mulx	%%rcx, %%rax, %%rcx   \n\t"
-			"  addq     %%rax, %%r8       \n\t" "   movq    %%r8,    (%0)  \n\t"
-			"  adcq     %%rcx, %%r10      \n\t" "   movq    %%r10,  8(%0)  \n\t"
+			"  mulx	%%rcx, %%r9, %%rcx    \n\t"
+			"  addq      %%r9, %%r8       \n\t"
+			"  adcq     %%rcx, %%r10      \n\t"
+			"  adcq        $0, %%r12      \n\t"
+			"  adcq        $0, %%rax      \n\t"
+			"  movl        $0, %%ebx      \n\t"
+			"  cmovc    %%rdx, %%rbx      # past 2^256: 38 more \n\t"
+			"  addq     %%rbx, %%r8       \n\t" "   movq    %%r8,    (%0)  \n\t"
+			                                  "   movq    %%r10,  8(%0)  \n\t"
+			                                  "   movq    %%r12, 16(%0)  \n\t"
+			                                  "   movq    %%rax, 24(%0)  \n\t"
 	:
 	: "r"  (c), "r" (a)
 	: "memory", "cc", "%rax", "%rbx", "%rcx", "%rdx", "%r8", "%r9", "%r10", "%r11", "%r12", "%r13"
@@ -817,10 +862,267 @@ void inv_EltFp25519_1w_x64(uint64_t *const pC, uint64_t *const pA)
 #undef sqrn_EltFp25519_1w_x64
 }
 
+/**
+ * Final reduction to the canonical representative in [0, p).
+ *
+ * The bit 255 is folded in first, which leaves c < 2^255+19. Then c >= p
+ * exactly when c+19 >= 2^255, in which case c-p = c+19-2^255. Both steps
+ * propagate their carries and select the result without branches.
+ **/
 inline void fred_EltFp25519_1w_x64(uint64_t *const c)
 {
-	int64_t last = (((int64_t*)c)[3])>>63;
+	uint64_t t[NUM_WORDS_ELTFP25519_X64];
+	uint64_t carry, mask;
+	int i;
+
+	carry = 19 * (c[3] >> 63);
 	c[3] &= ((uint64_t)1<<63)-1;
-	c[0] += 19 & last;
+	for (i = 0; i < NUM_WORDS_ELTFP25519_X64; i++)
+	{
+		c[i] += carry;
+		carry = c[i] < carry;
+	}
+
+	carry = 19;
+	for (i = 0; i < NUM_WORDS_ELTFP25519_X64; i++)
+	{
+		t[i] = c[i] + carry;
+		carry = t[i] < carry;
+	}
+	mask = -(t[3] >> 63);
+	t[3] &= ((uint64_t)1<<63)-1;
+	for (i = 0; i < NUM_WORDS_ELTFP25519_X64; i++)
+	{
+		c[i] = (t[i] & mask) | (c[i] & ~mask);
+	}
+}
+
+/**
+ * Variable-time inversion, Bernstein-Yang safegcd with the divstep batching
+ * and the variable-time tricks of libsecp256k1's modinv64_var.
+ *
+ * Numbers are in signed radix-2^62, five limbs. Each round does 62 divsteps
+ * on the bottom limbs of f and g alone, collecting them into a 2x2 matrix
+ * scaled by 2^62, and then applies the matrix to the full f, g (exact
+ * division by 2^62) and to d, e (division by 2^62 modulo p). f starts as p,
+ * g as the input, and when g reaches zero f is +-1 and d is +-1/input.
+ *
+ * The running time depends on the input: for public data only. Returns 0 for 0.
+ **/
+__extension__ typedef __int128 int128_fp25519;
+
+typedef struct { int64_t v[5]; } Signed62_fp25519;
+typedef struct { int64_t u, v, q, r; } Trans2x2_fp25519;
+
+#define M62_FP25519 (UINT64_MAX >> 2)
+
+static const Signed62_fp25519 prime62_fp25519 = {{
+	(int64_t)0x3fffffffffffffed, (int64_t)0x3fffffffffffffff,
+	(int64_t)0x3fffffffffffffff, (int64_t)0x3fffffffffffffff, 127}};
+/* p^-1 mod 2^62 */
+static const uint64_t prime_inv62_fp25519 = 0x39435e50d79435e5;
+
+static int64_t divsteps_62_var_fp25519(int64_t eta, uint64_t f0, uint64_t g0, Trans2x2_fp25519 *t)
+{
+	uint64_t u = 1, v = 0, q = 0, r = 1;
+	uint64_t f = f0, g = g0, m, w, tmp;
+	int i = 62, limit, zeros;
+
+	for (;;)
+	{
+		/* All the divsteps that just halve g at once; the sentinel stops at i. */
+		zeros = __builtin_ctzll(g | (UINT64_MAX << i));
+		g >>= zeros;
+		u <<= zeros;
+		v <<= zeros;
+		eta -= zeros;
+		i -= zeros;
+		if (i == 0)
+		{
+			break;
+		}
+		/* f and g are odd here; at most i steps are left and the sign of eta
+		 * flips again after eta+1 of them, which bounds what one go cancels. */
+		if (eta < 0)
+		{
+			/* Swap to (g, -f), then cancel up to 6 bottom bits of g at once. */
+			eta = -eta;
+			tmp = f; f = g; g = -tmp;
+			tmp = u; u = q; q = -tmp;
+			tmp = v; v = r; r = -tmp;
+			limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+			m = (UINT64_MAX >> (64 - limit)) & 63U;
+			w = (f * g * (f * f - 2)) & m;
+		}
+		else
+		{
+			/* Up to 4 bits: eta tends to be small on this side. */
+			limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+			m = (UINT64_MAX >> (64 - limit)) & 15U;
+			w = f + (((f + 1) & 4) << 1);
+			w = (-w * g) & m;
+		}
+		g += f * w;
+		q += u * w;
+		r += v * w;
+	}
+	t->u = (int64_t)u;
+	t->v = (int64_t)v;
+	t->q = (int64_t)q;
+	t->r = (int64_t)r;
+	return eta;
+}
+
+/* [d, e] = t [d, e] / 2^62 mod p, keeping both in (-2p, p). */
+static void update_de_62_fp25519(Signed62_fp25519 *d, Signed62_fp25519 *e, const Trans2x2_fp25519 *t)
+{
+	const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+	const int64_t *P = prime62_fp25519.v;
+	int64_t sd, se, md, me;
+	int128_fp25519 cd, ce;
+	int i;
+
+	/* Add p times [md, me], chosen to make the bottom 62 bits zero. */
+	sd = d->v[4] >> 63;
+	se = e->v[4] >> 63;
+	md = (u & sd) + (v & se);
+	me = (q & sd) + (r & se);
+	cd = (int128_fp25519)u * d->v[0] + (int128_fp25519)v * e->v[0];
+	ce = (int128_fp25519)q * d->v[0] + (int128_fp25519)r * e->v[0];
+	md -= (prime_inv62_fp25519 * (uint64_t)cd + md) & M62_FP25519;
+	me -= (prime_inv62_fp25519 * (uint64_t)ce + me) & M62_FP25519;
+	cd += (int128_fp25519)P[0] * md;
+	ce += (int128_fp25519)P[0] * me;
+	cd >>= 62;
+	ce >>= 62;
+
+	for (i = 1; i < 5; i++)
+	{
+		cd += (int128_fp25519)u * d->v[i] + (int128_fp25519)v * e->v[i] + (int128_fp25519)P[i] * md;
+		ce += (int128_fp25519)q * d->v[i] + (int128_fp25519)r * e->v[i] + (int128_fp25519)P[i] * me;
+		d->v[i - 1] = (int64_t)((uint64_t)cd & M62_FP25519);
+		e->v[i - 1] = (int64_t)((uint64_t)ce & M62_FP25519);
+		cd >>= 62;
+		ce >>= 62;
+	}
+	d->v[4] = (int64_t)cd;
+	e->v[4] = (int64_t)ce;
+}
+
+/* [f, g] = t [f, g] / 2^62 over the bottom `len` limbs; the division is exact. */
+static void update_fg_62_var_fp25519(int len, Signed62_fp25519 *f, Signed62_fp25519 *g, const Trans2x2_fp25519 *t)
+{
+	const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int128_fp25519 cf, cg;
+	int i;
+
+	cf = (int128_fp25519)u * f->v[0] + (int128_fp25519)v * g->v[0];
+	cg = (int128_fp25519)q * f->v[0] + (int128_fp25519)r * g->v[0];
+	cf >>= 62;
+	cg >>= 62;
+	for (i = 1; i < len; i++)
+	{
+		cf += (int128_fp25519)u * f->v[i] + (int128_fp25519)v * g->v[i];
+		cg += (int128_fp25519)q * f->v[i] + (int128_fp25519)r * g->v[i];
+		f->v[i - 1] = (int64_t)((uint64_t)cf & M62_FP25519);
+		g->v[i - 1] = (int64_t)((uint64_t)cg & M62_FP25519);
+		cf >>= 62;
+		cg >>= 62;
+	}
+	f->v[len - 1] = (int64_t)cf;
+	g->v[len - 1] = (int64_t)cg;
+}
+
+/* Brings r from (-2p, p) to [0, p), negated first when sign < 0. */
+static void normalize_62_fp25519(Signed62_fp25519 *r, int64_t sign)
+{
+	const int64_t *P = prime62_fp25519.v;
+	int64_t cond;
+	int i, pass;
+
+	cond = r->v[4] >> 63;
+	for (i = 0; i < 5; i++)
+	{
+		r->v[i] += P[i] & cond;
+	}
+	cond = sign >> 63;
+	for (i = 0; i < 5; i++)
+	{
+		r->v[i] = (r->v[i] ^ cond) - cond;
+	}
+	for (pass = 0; pass < 2; pass++)
+	{
+		for (i = 0; i < 4; i++)
+		{
+			r->v[i + 1] += r->v[i] >> 62;
+			r->v[i] &= M62_FP25519;
+		}
+		if (pass == 0)
+		{
+			cond = r->v[4] >> 63;
+			for (i = 0; i < 5; i++)
+			{
+				r->v[i] += P[i] & cond;
+			}
+		}
+	}
 }
 
+void inv_var_EltFp25519_1w_x64(uint64_t *const pC, uint64_t *const pA)
+{
+	Signed62_fp25519 d = {{0, 0, 0, 0, 0}};
+	Signed62_fp25519 e = {{1, 0, 0, 0, 0}};
+	Signed62_fp25519 f = prime62_fp25519;
+	Signed62_fp25519 g;
+	Trans2x2_fp25519 t;
+	EltFp25519_1w_x64 a;
+	int64_t eta = -1, cond, fn, gn;
+	int j, len = 5;
+
+	copy_EltFp25519_1w_x64(a, pA);
+	fred_EltFp25519_1w_x64(a);
+	g.v[0] = (int64_t)(a[0] & M62_FP25519);
+	g.v[1] = (int64_t)(((a[0] >> 62) | (a[1] << 2)) & M62_FP25519);
+	g.v[2] = (int64_t)(((a[1] >> 60) | (a[2] << 4)) & M62_FP25519);
+	g.v[3] = (int64_t)(((a[2] >> 58) | (a[3] << 6)) & M62_FP25519);
+	g.v[4] = (int64_t)(a[3] >> 56);
+
+	for (;;)
+	{
+		eta = divsteps_62_var_fp25519(eta, (uint64_t)f.v[0], (uint64_t)g.v[0], &t);
+		update_de_62_fp25519(&d, &e, &t);
+		update_fg_62_var_fp25519(len, &f, &g, &t);
+
+		if (g.v[0] == 0)
+		{
+			cond = 0;
+			for (j = 1; j < len; j++)
+			{
+				cond |= g.v[j];
+			}
+			if (cond == 0)
+			{
+				break;
+			}
+		}
+
+		/* Drop the top limbs of f and g once both are just sign extension. */
+		fn = f.v[len - 1];
+		gn = g.v[len - 1];
+		cond = ((int64_t)len - 2) >> 63;
+		cond |= fn ^ (fn >> 63);
+		cond |= gn ^ (gn >> 63);
+		if (cond == 0)
+		{
+			f.v[len - 2] = (int64_t)((uint64_t)f.v[len - 2] | ((uint64_t)fn << 62));
+			g.v[len - 2] = (int64_t)((uint64_t)g.v[len - 2] | ((uint64_t)gn << 62));
+			len--;
+		}
+	}
+
+	normalize_62_fp25519(&d, f.v[len - 1]);
+	pC[0] = (uint64_t)d.v[0] | ((uint64_t)d.v[1] << 62);
+	pC[1] = ((uint64_t)d.v[1] >> 2) | ((uint64_t)d.v[2] << 60);
+	pC[2] = ((uint64_t)d.v[2] >> 4) | ((uint64_t)d.v[3] << 58);
+	pC[3] = ((uint64_t)d.v[3] >> 6) | ((uint64_t)d.v[4] << 56);
+}
@@ -143,7 +143,7 @@ static void x25519_shared_secret_x64(argKey shared, argKey session_key, argKey p
 	private_key[0]  = (uint8_t)(save & 0xFF);
 }
 
-static void x25519_keygen_precmp_x64(argKey session_key, argKey private_key)
+void x25519_keygen_precmp_x64(argKey session_key, argKey private_key)
 {
 	ALIGN uint64_t buffer[4*NUM_WORDS_ELTFP25519_X64];
 	ALIGN uint64_t coordinates[4*NUM_WORDS_ELTFP25519_X64];